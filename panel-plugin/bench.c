@@ -0,0 +1,363 @@
+/*  $Id$
+ *
+ *  Copyright (C) 2003 Choe Hwanjin(krisna@kldp.org)
+ *  Copyright (c) 2006 Remco den Breeje <remco@sx.mine.nu>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Benchmark of the formatting and scheduling core, without GTK:
+ *
+ *   bench [ITERATIONS [LOCALE...]]
+ *
+ * renders every preset format in each locale and prints the time and
+ * allocations per render, then the wakeups per 24 hours of every layout
+ * in the local zone.  Run it with e.g. TZ=Europe/Berlin to include
+ * a switch to summer time in the simulated day.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+/* local includes */
+#include <time.h>
+#include <string.h>
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* xfce includes */
+#include <libxfce4util/libxfce4util.h>
+
+#include "datetime-format.h"
+#include "datetime-layout.h"
+#include "datetime-presets.h"
+#include "datetime-tick.h"
+#include "datetime-world.h"
+#include "datetime-zone.h"
+
+#define BENCH_ITERATIONS 100000
+
+/* 2024-03-30 12:00 UTC, half a day before the European switch to summer time */
+#define BENCH_START_MS G_GINT64_CONSTANT(1711800000000)
+#define BENCH_DAY_MS   G_GINT64_CONSTANT(86400000)
+
+/* seconds between refreshes in power saving mode */
+#define BENCH_TIMER_SLACK 10
+
+#define BENCH_WORLD_ZONES "New York=America/New_York;Asia/Tokyo;UTC"
+
+static const gchar *bench_locales[] = {
+  "C",
+  "en_US.UTF-8",
+  "de_DE.UTF-8",
+  "ru_RU.UTF-8",
+  "ja_JP.UTF-8",
+  "ru_RU.KOI8-R",  /* not UTF-8: converted on every render */
+  NULL
+};
+
+static const gchar *bench_layout_names[LAYOUT_COUNT] = {
+  "date+time", "time+date", "date", "time", "world"
+};
+
+/*
+ * count the allocations of glib and libc by wrapping the allocator;
+ * glibc exports the real one under __libc_*
+ */
+static guint64 bench_allocs;
+
+#ifdef __GLIBC__
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size)
+{
+  bench_allocs++;
+  return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+  bench_allocs++;
+  return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+  bench_allocs++;
+  return __libc_realloc(ptr, size);
+}
+#define BENCH_COUNTS_ALLOCS TRUE
+#else
+#define BENCH_COUNTS_ALLOCS FALSE
+#endif
+
+/*
+ * a different time for every iteration, without paying for the conversion
+ */
+static void bench_advance(struct tm *tm, const struct tm *start, guint i)
+{
+  *tm = *start;
+  tm->tm_sec = i % 60;
+  tm->tm_min = (start->tm_min + i / 60) % 60;
+}
+
+static void bench_print(const gchar *what, gint64 elapsed_us,
+                        guint64 allocs, guint iterations)
+{
+  if (BENCH_COUNTS_ALLOCS)
+    printf("  %-24s %10.1f ns/op %8.2f allocs/op\n", what,
+           elapsed_us * 1000.0 / iterations, (gdouble) allocs / iterations);
+  else
+    printf("  %-24s %10.1f ns/op        n/a allocs/op\n", what,
+           elapsed_us * 1000.0 / iterations);
+}
+
+static void bench_format(const gchar *format, const struct tm *start,
+                         guint iterations)
+{
+  t_datetime_format *program;
+  gchar buf[DATETIME_MAX_STRLEN];
+  gchar *what, *utf8str;
+  struct tm tm;
+  guint64 allocs;
+  gint64 start_time;
+  guint i;
+
+  program = datetime_format_compile(format);
+
+  /* warm up the locale data and the converters */
+  g_free(datetime_format_render_utf8(program, start, 0));
+
+  allocs = bench_allocs;
+  start_time = g_get_monotonic_time();
+  for (i = 0; i < iterations; i++)
+  {
+    bench_advance(&tm, start, i);
+    datetime_format_render(program, &tm, 0, buf, sizeof(buf));
+  }
+  what = g_strdup_printf("%s", format);
+  bench_print(what, g_get_monotonic_time() - start_time,
+              bench_allocs - allocs, iterations);
+  g_free(what);
+
+  allocs = bench_allocs;
+  start_time = g_get_monotonic_time();
+  for (i = 0; i < iterations; i++)
+  {
+    bench_advance(&tm, start, i);
+    utf8str = datetime_format_render_utf8(program, &tm, 0);
+    g_free(utf8str);
+  }
+  what = g_strdup_printf("%s (utf8)", format);
+  bench_print(what, g_get_monotonic_time() - start_time,
+              bench_allocs - allocs, iterations);
+  g_free(what);
+
+  datetime_format_free(program);
+}
+
+static void bench_world(const gchar *format, guint iterations)
+{
+  t_datetime_format *program;
+  t_datetime_world *world;
+  guint64 allocs;
+  gint64 start_time;
+  guint i;
+
+  program = datetime_format_compile(format);
+  world = datetime_world_new(BENCH_WORLD_ZONES);
+  g_free(datetime_world_render(world, program, BENCH_START_MS));
+
+  /* NULL when no clock changed, 59 seconds in 60 with %H:%M */
+  allocs = bench_allocs;
+  start_time = g_get_monotonic_time();
+  for (i = 0; i < iterations; i++)
+    g_free(datetime_world_render(world, program, BENCH_START_MS + i * 1000));
+  bench_print(format, g_get_monotonic_time() - start_time,
+              bench_allocs - allocs, iterations);
+
+  datetime_world_free(world);
+  datetime_format_free(program);
+}
+
+static void bench_locale(const gchar *locale, guint iterations)
+{
+  struct tm start;
+  guint i;
+
+  if (setlocale(LC_TIME, locale) == NULL)
+  {
+    printf("%s: not available, skipped\n\n", locale);
+    return;
+  }
+
+  printf("%s:\n", locale);
+  datetime_localtime(BENCH_START_MS / 1000, &start);
+  for (i = 0; i < DT_COMBOBOX_DATE_COUNT; i++)
+    if (dt_combobox_date[i].type == DT_COMBOBOX_ITEM_TYPE_STANDARD)
+      bench_format(dt_combobox_date[i].item, &start, iterations);
+  for (i = 0; i < DT_COMBOBOX_TIME_COUNT; i++)
+    if (dt_combobox_time[i].type == DT_COMBOBOX_ITEM_TYPE_STANDARD)
+      bench_format(dt_combobox_time[i].item, &start, iterations);
+  printf("\n");
+}
+
+static void bench_wakeups(void)
+{
+  t_datetime_format *program;
+  guint date_units[DT_COMBOBOX_DATE_COUNT];
+  guint time_units[DT_COMBOBOX_TIME_COUNT];
+  guint seen[DT_COMBOBOX_DATE_COUNT * DT_COMBOBOX_TIME_COUNT];
+  guint n_seen = 0;
+  guint units, d, t, i, layout;
+  gint64 start_time;
+  guint64 calls = 0;
+
+  for (d = 0; d < DT_COMBOBOX_DATE_COUNT; d++)
+  {
+    program = datetime_format_compile(dt_combobox_date[d].item);
+    date_units[d] = datetime_format_get_units(program);
+    datetime_format_free(program);
+  }
+  for (t = 0; t < DT_COMBOBOX_TIME_COUNT; t++)
+  {
+    program = datetime_format_compile(dt_combobox_time[t].item);
+    time_units[t] = datetime_format_get_units(program);
+    datetime_format_free(program);
+  }
+
+  printf("wakeups per 24 hours, precise / power saving every %u seconds:\n",
+         BENCH_TIMER_SLACK);
+  printf("  %-16s %-14s", "date", "time");
+  for (layout = 0; layout < LAYOUT_COUNT; layout++)
+    printf(" %13s", bench_layout_names[layout]);
+  printf("\n");
+
+  start_time = g_get_monotonic_time();
+  for (d = 0; d < DT_COMBOBOX_DATE_COUNT; d++)
+  {
+    if (dt_combobox_date[d].type != DT_COMBOBOX_ITEM_TYPE_STANDARD)
+      continue;
+
+    for (t = 0; t < DT_COMBOBOX_TIME_COUNT; t++)
+    {
+      if (dt_combobox_time[t].type != DT_COMBOBOX_ITEM_TYPE_STANDARD)
+        continue;
+
+      /* one row per combination of units, the others wake up alike */
+      units = date_units[d] | (time_units[t] << 16);
+      for (i = 0; i < n_seen && seen[i] != units; i++);
+      if (i < n_seen)
+        continue;
+      seen[n_seen++] = units;
+
+      printf("  %-16s %-14s", dt_combobox_date[d].item,
+             dt_combobox_time[t].item);
+      for (layout = 0; layout < LAYOUT_COUNT; layout++)
+      {
+        units = datetime_layout_get_units(layout, date_units[d], time_units[t]);
+        printf(" %6u", datetime_tick_count_wakeups(units, FALSE, BENCH_TIMER_SLACK,
+               BENCH_START_MS, BENCH_START_MS + BENCH_DAY_MS));
+
+        /* as datetime_update() schedules it */
+        if (units & DATETIME_UNIT_SUBSECOND)
+          units = (units & ~DATETIME_UNIT_SUBSECOND) | DATETIME_UNIT_SECOND;
+        printf("/%-6u", datetime_tick_count_wakeups(units, TRUE, BENCH_TIMER_SLACK,
+               BENCH_START_MS, BENCH_START_MS + BENCH_DAY_MS));
+        calls += 2;
+      }
+      printf("\n");
+    }
+  }
+  printf("  %.1f us per count of a day\n\n",
+         (gdouble) (g_get_monotonic_time() - start_time) / calls);
+}
+
+static void bench_scheduling(guint iterations)
+{
+  static const guint units[] = {
+    DATETIME_UNIT_SECOND,
+    DATETIME_UNIT_MINUTE,
+    DATETIME_UNIT_DAY | DATETIME_UNIT_MINUTE,
+    DATETIME_UNIT_WEEK | DATETIME_UNIT_MONTH | DATETIME_UNIT_YEAR
+  };
+  struct tm tm;
+  gchar *what;
+  gint64 time_ms, start_time;
+  guint64 allocs;
+  guint i, u;
+
+  printf("scheduling:\n");
+  allocs = bench_allocs;
+  start_time = g_get_monotonic_time();
+  for (i = 0; i < iterations; i++)
+    datetime_localtime(BENCH_START_MS / 1000 + i, &tm);
+  bench_print("datetime_localtime", g_get_monotonic_time() - start_time,
+              bench_allocs - allocs, iterations);
+
+  for (u = 0; u < G_N_ELEMENTS(units); u++)
+  {
+    allocs = bench_allocs;
+    start_time = g_get_monotonic_time();
+    for (i = 0; i < iterations; i++)
+    {
+      time_ms = BENCH_START_MS + (gint64) i * 1000;
+      datetime_localtime(time_ms / 1000, &tm);
+      datetime_next_change(units[u], time_ms, &tm);
+    }
+    what = g_strdup_printf("datetime_next_change 0x%x", units[u]);
+    bench_print(what, g_get_monotonic_time() - start_time,
+                bench_allocs - allocs, iterations);
+    g_free(what);
+  }
+  printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+  guint iterations = BENCH_ITERATIONS;
+  gint i;
+
+  if (argc > 1)
+    iterations = MAX(strtoul(argv[1], NULL, 10), 1);
+
+  if (argc > 2)
+  {
+    for (i = 2; i < argc; i++)
+      bench_locale(argv[i], iterations);
+  }
+  else
+  {
+    for (i = 0; bench_locales[i] != NULL; i++)
+      bench_locale(bench_locales[i], iterations);
+  }
+
+  setlocale(LC_TIME, "C");
+  printf("world clocks (%s):\n", BENCH_WORLD_ZONES);
+  for (i = 0; i < (gint) DT_COMBOBOX_TIME_COUNT; i++)
+    if (dt_combobox_time[i].type == DT_COMBOBOX_ITEM_TYPE_STANDARD)
+      bench_world(dt_combobox_time[i].item, iterations);
+  printf("\n");
+
+  bench_scheduling(iterations);
+  bench_wakeups();
+
+  return 0;
+}
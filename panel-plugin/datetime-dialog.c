@@ -33,6 +33,8 @@
 #include <libxfce4util/libxfce4util.h>
 #include <libxfce4panel/xfce-panel-plugin.h>
 
+#include "datetime-presets.h"
+#include "datetime-zone.h"
 #include "datetime.h"
 #include "datetime-dialog.h"
 
@@ -43,61 +45,10 @@ static const gchar *layout_strs[] = {
   N_("Date, then time"),
   N_("Time, then date"),
   N_("Date only"),
-  N_("Time only")
+  N_("Time only"),
+  N_("Time, then other time zones")
 };
 
-typedef enum {
-
-  /* standard format item; string is replaced with an example date or time */
-  DT_COMBOBOX_ITEM_TYPE_STANDARD,
-
-  /* custom format item; text is translated */
-  DT_COMBOBOX_ITEM_TYPE_CUSTOM,
-
-  /* inactive separator */
-  DT_COMBOBOX_ITEM_TYPE_SEPARATOR,
-
-} dt_combobox_item_type;
-
-typedef struct {
-  gchar *item;
-  dt_combobox_item_type type;
-} dt_combobox_item;
-
-/*
- * Builtin formats are derived from xfce4-panel-clock.patch by Nick Schermer.
- */
-static const dt_combobox_item dt_combobox_date[] = {
-  { "%Y-%m-%d",       DT_COMBOBOX_ITEM_TYPE_STANDARD  },
-  { "%Y %B %d",       DT_COMBOBOX_ITEM_TYPE_STANDARD  },
-  { "---",            DT_COMBOBOX_ITEM_TYPE_SEPARATOR },  /* placeholder */
-  { "%m/%d/%Y",       DT_COMBOBOX_ITEM_TYPE_STANDARD  },
-  { "%B %d, %Y",      DT_COMBOBOX_ITEM_TYPE_STANDARD  },
-  { "%b %d, %Y",      DT_COMBOBOX_ITEM_TYPE_STANDARD  },
-  { "%A, %B %d, %Y",  DT_COMBOBOX_ITEM_TYPE_STANDARD  },
-  { "%a, %b %d, %Y",  DT_COMBOBOX_ITEM_TYPE_STANDARD  },
-  { "---",            DT_COMBOBOX_ITEM_TYPE_SEPARATOR },  /* placeholder */
-  { "%d/%m/%Y",       DT_COMBOBOX_ITEM_TYPE_STANDARD  },
-  { "%d %B %Y",       DT_COMBOBOX_ITEM_TYPE_STANDARD  },
-  { "%d %b %Y",       DT_COMBOBOX_ITEM_TYPE_STANDARD  },
-  { "%A, %d %B %Y",   DT_COMBOBOX_ITEM_TYPE_STANDARD  },
-  { "%a, %d %b %Y",   DT_COMBOBOX_ITEM_TYPE_STANDARD  },
-  { "---",            DT_COMBOBOX_ITEM_TYPE_SEPARATOR },  /* placeholder */
-  { N_("Custom..."),  DT_COMBOBOX_ITEM_TYPE_CUSTOM    }
-};
-#define DT_COMBOBOX_DATE_COUNT (sizeof(dt_combobox_date)/sizeof(dt_combobox_item))
-
-static const dt_combobox_item dt_combobox_time[] = {
-  { "%H:%M",          DT_COMBOBOX_ITEM_TYPE_STANDARD  },
-  { "%H:%M:%S",       DT_COMBOBOX_ITEM_TYPE_STANDARD  },
-  { "---",            DT_COMBOBOX_ITEM_TYPE_SEPARATOR },  /* placeholder */
-  { "%l:%M %P",       DT_COMBOBOX_ITEM_TYPE_STANDARD  },
-  { "%l:%M:%S %P",    DT_COMBOBOX_ITEM_TYPE_STANDARD  },
-  { "---",            DT_COMBOBOX_ITEM_TYPE_SEPARATOR },  /* placeholder */
-  { N_("Custom..."),  DT_COMBOBOX_ITEM_TYPE_CUSTOM    }
-};
-#define DT_COMBOBOX_TIME_COUNT (sizeof(dt_combobox_time)/sizeof(dt_combobox_item))
-
 /*
  * Example timestamp to show in the dialog.
  * Compute with:
@@ -105,6 +56,9 @@ static const dt_combobox_item dt_combobox_time[] = {
  */
 static const time_t example_time_t = 946684799;
 
+/* how long typing has to pause before the format preview is refreshed */
+#define DATETIME_PREVIEW_DELAY_MS 300
+
 /*
  * show and read fonts and inform datetime about it
  */
@@ -120,13 +74,13 @@ static void datetime_font_selection_cb(GtkWidget *widget, t_datetime *dt)
   {
     target = DATE;
     fontname = dt->date_font;
-    previewtext = gtk_label_get_text(GTK_LABEL(dt->date_label));
+    previewtext = datetime_display_get_text(dt->display, DATE);
   }
   else /*time_font_selector */
   {
     target = TIME;
     fontname = dt->time_font;
-    previewtext = gtk_label_get_text(GTK_LABEL(dt->time_label));
+    previewtext = datetime_display_get_text(dt->display, TIME);
   }
 
   dialog = gtk_font_chooser_dialog_new(_("Select font"),
@@ -183,6 +137,7 @@ datetime_layout_changed(GtkComboBox *cbox, t_datetime *dt)
       break;
 
     case LAYOUT_TIME:
+    case LAYOUT_WORLD:
       gtk_widget_hide(dt->date_font_hbox);
       gtk_widget_show(dt->date_tooltip_label);
 
@@ -198,8 +153,74 @@ datetime_layout_changed(GtkComboBox *cbox, t_datetime *dt)
       gtk_widget_hide(dt->time_tooltip_label);
   }
 
+  gtk_widget_set_sensitive(dt->time_zones_entry, layout == LAYOUT_WORLD);
+
   datetime_apply_layout(dt, layout);
-  datetime_update(dt);
+}
+
+/*
+ * read the time zones entry and inform datetime about it
+ */
+static gboolean
+datetime_time_zones_changed(GtkWidget *widget, GdkEventFocus *ev, t_datetime *dt)
+{
+  datetime_apply_time_zones(dt, gtk_entry_get_text(GTK_ENTRY(widget)));
+  return FALSE;
+}
+
+static void
+datetime_time_zones_activate(GtkEntry *entry, t_datetime *dt)
+{
+  datetime_time_zones_changed(GTK_WIDGET(entry), NULL, dt);
+}
+
+/*
+ * read the calendars entry and inform datetime about it
+ */
+static gboolean
+datetime_calendars_changed(GtkWidget *widget, GdkEventFocus *ev, t_datetime *dt)
+{
+  datetime_apply_calendars(dt, gtk_entry_get_text(GTK_ENTRY(widget)));
+  return FALSE;
+}
+
+static void
+datetime_calendars_activate(GtkEntry *entry, t_datetime *dt)
+{
+  datetime_calendars_changed(GTK_WIDGET(entry), NULL, dt);
+}
+
+/*
+ * Read power saving mode and timer slack
+ */
+static void
+datetime_power_saving_changed(GtkWidget *widget, t_datetime *dt)
+{
+  GtkWidget *check;
+
+  check = g_object_get_data(G_OBJECT(dt->timer_slack_spin), "power-saving-check");
+  gtk_widget_set_sensitive(dt->timer_slack_spin,
+                           gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(check)));
+
+  datetime_apply_power_saving(dt,
+      gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(check)),
+      gtk_spin_button_get_value_as_int(GTK_SPIN_BUTTON(dt->timer_slack_spin)));
+}
+
+/*
+ * show the current statistics
+ */
+static gboolean
+datetime_stats_refresh(gpointer user_data)
+{
+  t_datetime *dt = user_data;
+  gchar *str;
+
+  str = datetime_stats_to_string(&dt->stats);
+  gtk_label_set_text(GTK_LABEL(dt->stats_label), str);
+  g_free(str);
+
+  return TRUE;
 }
 
 /*
@@ -222,6 +243,138 @@ combo_box_row_separator(GtkTreeModel *model,
   return items[current].type == DT_COMBOBOX_ITEM_TYPE_SEPARATOR;
 }
 
+/*
+ * how often a format with these units changes
+ */
+static const gchar *
+datetime_units_granularity(guint units)
+{
+  if (units & DATETIME_UNIT_SUBSECOND)
+    return _("Changes several times per second");
+  if (units & DATETIME_UNIT_SECOND)
+    return _("Changes every second");
+  if (units & DATETIME_UNIT_MINUTE)
+    return _("Changes every minute");
+  if (units & DATETIME_UNIT_HOUR)
+    return _("Changes every hour");
+  if (units & DATETIME_UNIT_DAY)
+    return _("Changes every day");
+  if (units & (DATETIME_UNIT_WEEK | DATETIME_UNIT_WEEK_SUN))
+    return _("Changes every week");
+  if (units & DATETIME_UNIT_MONTH)
+    return _("Changes every month");
+  if (units & DATETIME_UNIT_YEAR)
+    return _("Changes every year");
+  return _("Never changes");
+}
+
+/*
+ * Show what the format being typed looks like now, how often it changes
+ * and how often the plugin would wake up with it.
+ */
+static void
+datetime_format_preview(t_datetime *dt, GtkWidget *entry, GtkWidget *preview)
+{
+  t_datetime_format *program;
+  gchar buf[DATETIME_MAX_STRLEN];
+  gchar *utf8str = NULL;
+  gchar *str;
+  guint units, date_units, time_units, layout_units, wakeups;
+  gint64 now_ms;
+  struct tm tm;
+
+  if (!gtk_widget_get_visible(entry))
+    return;
+
+  program = datetime_format_compile(gtk_entry_get_text(GTK_ENTRY(entry)));
+  now_ms = datetime_tick_get_time();
+  datetime_localtime(now_ms / 1000, &tm);
+
+  if (datetime_format_render(program, &tm, now_ms % 1000, buf, sizeof(buf)-1) > 0)
+    utf8str = g_locale_to_utf8(buf, -1, NULL, NULL, NULL);
+
+  if (utf8str == NULL)
+  {
+    gtk_label_set_text(GTK_LABEL(preview), _("Invalid format"));
+    datetime_format_free(program);
+    return;
+  }
+
+  /* count the wakeups the way datetime_set_update_interval() sets them up */
+  units = datetime_format_get_units(program);
+  if (entry == dt->date_format_entry)
+  {
+    date_units = units;
+    time_units = datetime_format_get_units(dt->time_program);
+  }
+  else
+  {
+    date_units = datetime_format_get_units(dt->date_program);
+    time_units = units;
+  }
+  layout_units = datetime_layout_get_units(dt->layout, date_units, time_units);
+
+  /* see datetime_update(): the frame clock or the seconds take over */
+  if ((layout_units & DATETIME_UNIT_SUBSECOND) && !dt->power_saving)
+  {
+    str = g_strdup_printf(_("%s\n%s, the panel is redrawn on every frame"),
+                          utf8str, datetime_units_granularity(units));
+  }
+  else
+  {
+    if (layout_units & DATETIME_UNIT_SUBSECOND)
+      layout_units = (layout_units & ~DATETIME_UNIT_SUBSECOND) | DATETIME_UNIT_SECOND;
+
+    wakeups = datetime_tick_count_wakeups(layout_units,
+        dt->power_saving, dt->timer_slack,
+        now_ms, now_ms + 24 * 60 * 60 * 1000);
+
+    /* per hour only if that is exact, 47 wakeups a day aren't 1 per hour */
+    if (wakeups >= 24 && wakeups % 24 == 0)
+      str = g_strdup_printf(g_dngettext(GETTEXT_PACKAGE,
+                                        "%s\n%s, the plugin wakes up %u time per hour",
+                                        "%s\n%s, the plugin wakes up %u times per hour",
+                                        wakeups / 24),
+                            utf8str, datetime_units_granularity(units), wakeups / 24);
+    else
+      str = g_strdup_printf(g_dngettext(GETTEXT_PACKAGE,
+                                        "%s\n%s, the plugin wakes up %u time per day",
+                                        "%s\n%s, the plugin wakes up %u times per day",
+                                        wakeups),
+                            utf8str, datetime_units_granularity(units), wakeups);
+  }
+  gtk_label_set_text(GTK_LABEL(preview), str);
+
+  g_free(str);
+  g_free(utf8str);
+  datetime_format_free(program);
+}
+
+static gboolean
+datetime_format_preview_timeout(gpointer user_data)
+{
+  t_datetime *dt = user_data;
+
+  dt->format_preview_timeout_id = 0;
+  datetime_format_preview(dt, dt->date_format_entry, dt->date_format_preview);
+  datetime_format_preview(dt, dt->time_format_entry, dt->time_format_preview);
+
+  return FALSE;
+}
+
+/*
+ * refresh the previews once typing pauses
+ */
+static void
+datetime_entry_changed(GtkEditable *editable, t_datetime *dt)
+{
+  if (dt->format_preview_timeout_id != 0)
+    g_source_remove(dt->format_preview_timeout_id);
+
+  dt->format_preview_timeout_id = g_timeout_add(DATETIME_PREVIEW_DELAY_MS,
+      datetime_format_preview_timeout, dt);
+}
+
 /*
  * Read date format from combobox and set sensitivity
  */
@@ -235,18 +388,19 @@ date_format_changed(GtkComboBox *cbox, t_datetime *dt)
     case DT_COMBOBOX_ITEM_TYPE_STANDARD:
       /* hide custom text entry box and tell datetime which format is selected */
       gtk_widget_hide(dt->date_format_entry);
+      gtk_widget_hide(dt->date_format_preview);
       datetime_apply_format(dt, dt_combobox_date[active].item, NULL);
       break;
     case DT_COMBOBOX_ITEM_TYPE_CUSTOM:
       /* initialize custom text entry box with current format and show the box */
       gtk_entry_set_text(GTK_ENTRY(dt->date_format_entry), dt->date_format);
       gtk_widget_show(dt->date_format_entry);
+      gtk_widget_show(dt->date_format_preview);
+      datetime_format_preview(dt, dt->date_format_entry, dt->date_format_preview);
       break;
     default:
       break; /* separators should never be active */
   }
-
-  datetime_update(dt);
 }
 
 /*
@@ -262,18 +416,19 @@ time_format_changed(GtkComboBox *cbox, t_datetime *dt)
     case DT_COMBOBOX_ITEM_TYPE_STANDARD:
       /* hide custom text entry box and tell datetime which format is selected */
       gtk_widget_hide(dt->time_format_entry);
+      gtk_widget_hide(dt->time_format_preview);
       datetime_apply_format(dt, NULL, dt_combobox_time[active].item);
       break;
     case DT_COMBOBOX_ITEM_TYPE_CUSTOM:
       /* initialize custom text entry box with current format and show the box */
       gtk_entry_set_text(GTK_ENTRY(dt->time_format_entry), dt->time_format);
       gtk_widget_show(dt->time_format_entry);
+      gtk_widget_show(dt->time_format_preview);
+      datetime_format_preview(dt, dt->time_format_entry, dt->time_format_preview);
       break;
     default:
       break; /* separators should never be active */
   }
-
-  datetime_update(dt);
 }
 
 /*
@@ -291,7 +446,6 @@ datetime_entry_change_cb(GtkWidget *widget, GdkEventFocus *ev, t_datetime *dt)
     else if(widget == dt->time_format_entry)    /* or time */
       datetime_apply_format(dt, NULL, format);
   }
-  datetime_update(dt);
   return FALSE;
 }
 
@@ -318,6 +472,18 @@ datetime_dialog_response(GtkWidget *dlg, int response, t_datetime *dt)
   {
     g_object_set_data(G_OBJECT(dt->plugin), "dialog", NULL);
 
+    if (dt->format_preview_timeout_id != 0)
+    {
+      g_source_remove(dt->format_preview_timeout_id);
+      dt->format_preview_timeout_id = 0;
+    }
+
+    if (dt->stats_timeout_id != 0)
+    {
+      g_source_remove(dt->stats_timeout_id);
+      dt->stats_timeout_id = 0;
+    }
+
     gtk_widget_destroy(dlg);
     datetime_write_rc_file(dt->plugin, dt);
   }
@@ -361,6 +527,8 @@ datetime_properties_dialog(XfcePanelPlugin *plugin, t_datetime * datetime)
             *date_combobox,
             *label,
             *button,
+            *check,
+            *spin,
             *entry,
             *bin;
   GtkSizeGroup  *sg;
@@ -416,6 +584,80 @@ datetime_properties_dialog(XfcePanelPlugin *plugin, t_datetime * datetime)
   g_signal_connect(G_OBJECT(layout_combobox), "changed",
       G_CALLBACK(datetime_layout_changed), datetime);
 
+  /* hbox */
+  hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 12);
+  gtk_box_pack_start(GTK_BOX(vbox), hbox, FALSE, FALSE, 0);
+
+  /* time zones of the world clock layout */
+  label = gtk_label_new(_("Time zones:"));
+  gtk_label_set_xalign (GTK_LABEL (label), 0.0f);
+  gtk_box_pack_start(GTK_BOX(hbox), label, FALSE, FALSE, 0);
+  gtk_size_group_add_widget(sg, label);
+
+  entry = gtk_entry_new();
+  gtk_entry_set_text(GTK_ENTRY(entry), datetime->time_zones);
+  gtk_entry_set_placeholder_text(GTK_ENTRY(entry), "NYC=America/New_York; Asia/Tokyo");
+  gtk_widget_set_tooltip_text(entry,
+      _("Time zones to show after the time, separated by semicolons. "
+        "Put a label and \"=\" in front of a zone to name it."));
+  gtk_box_pack_start(GTK_BOX(hbox), entry, TRUE, TRUE, 0);
+  g_signal_connect(G_OBJECT(entry), "focus-out-event",
+      G_CALLBACK(datetime_time_zones_changed), datetime);
+  g_signal_connect(G_OBJECT(entry), "activate",
+      G_CALLBACK(datetime_time_zones_activate), datetime);
+  datetime->time_zones_entry = entry;
+
+  /* hbox */
+  hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 12);
+  gtk_box_pack_start(GTK_BOX(vbox), hbox, FALSE, FALSE, 0);
+
+  /* iCalendar files of the calendar popup */
+  label = gtk_label_new(_("Calendars:"));
+  gtk_label_set_xalign (GTK_LABEL (label), 0.0f);
+  gtk_box_pack_start(GTK_BOX(hbox), label, FALSE, FALSE, 0);
+  gtk_size_group_add_widget(sg, label);
+
+  entry = gtk_entry_new();
+  gtk_entry_set_text(GTK_ENTRY(entry), datetime->calendars);
+  gtk_entry_set_placeholder_text(GTK_ENTRY(entry), "~/calendar.ics");
+  gtk_widget_set_tooltip_text(entry,
+      _("iCalendar files whose events are marked in the calendar, "
+        "separated by semicolons."));
+  gtk_box_pack_start(GTK_BOX(hbox), entry, TRUE, TRUE, 0);
+  g_signal_connect(G_OBJECT(entry), "focus-out-event",
+      G_CALLBACK(datetime_calendars_changed), datetime);
+  g_signal_connect(G_OBJECT(entry), "activate",
+      G_CALLBACK(datetime_calendars_activate), datetime);
+  datetime->calendars_entry = entry;
+
+  /* hbox */
+  hbox = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 12);
+  gtk_box_pack_start(GTK_BOX(vbox), hbox, FALSE, FALSE, 0);
+
+  /* power saving check button and timer slack */
+  check = gtk_check_button_new_with_label(_("Save power, show seconds every"));
+  gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(check), datetime->power_saving);
+  gtk_widget_set_tooltip_text(check,
+      _("Group updates with other wakeups of the system; "
+        "changes of the minute, hour or day show up to a second late. "
+        "Formats showing seconds are only refreshed every few seconds."));
+  gtk_box_pack_start(GTK_BOX(hbox), check, FALSE, FALSE, 0);
+
+  spin = gtk_spin_button_new_with_range(1, 60, 1);
+  gtk_spin_button_set_value(GTK_SPIN_BUTTON(spin), datetime->timer_slack);
+  gtk_widget_set_sensitive(spin, datetime->power_saving);
+  gtk_box_pack_start(GTK_BOX(hbox), spin, FALSE, FALSE, 0);
+  g_object_set_data(G_OBJECT(spin), "power-saving-check", check);
+  datetime->timer_slack_spin = spin;
+
+  label = gtk_label_new(_("seconds"));
+  gtk_box_pack_start(GTK_BOX(hbox), label, FALSE, FALSE, 0);
+
+  g_signal_connect(G_OBJECT(check), "toggled",
+      G_CALLBACK(datetime_power_saving_changed), datetime);
+  g_signal_connect(G_OBJECT(spin), "value-changed",
+      G_CALLBACK(datetime_power_saving_changed), datetime);
+
   /* show frame */
   gtk_widget_show_all(frame);
 
@@ -505,6 +747,14 @@ datetime_properties_dialog(XfcePanelPlugin *plugin, t_datetime * datetime)
       G_CALLBACK(date_format_changed), datetime);
   datetime->date_format_combobox = date_combobox;
 
+  /* preview of the custom format, below its entry */
+  label = gtk_label_new(NULL);
+  gtk_label_set_xalign (GTK_LABEL (label), 1.0f);
+  gtk_label_set_justify(GTK_LABEL(label), GTK_JUSTIFY_RIGHT);
+  gtk_style_context_add_class(gtk_widget_get_style_context(label), "dim-label");
+  gtk_box_pack_end(GTK_BOX(vbox), label, FALSE, FALSE, 0);
+  datetime->date_format_preview = label;
+
   /* format entry */
   entry = gtk_entry_new();
   gtk_entry_set_text(GTK_ENTRY(entry), datetime->date_format);
@@ -512,6 +762,8 @@ datetime_properties_dialog(XfcePanelPlugin *plugin, t_datetime * datetime)
   gtk_box_pack_end(GTK_BOX(vbox), entry, FALSE, FALSE, 0);
   g_signal_connect (G_OBJECT(entry), "focus-out-event",
                     G_CALLBACK (datetime_entry_change_cb), datetime);
+  g_signal_connect (G_OBJECT(entry), "changed",
+                    G_CALLBACK (datetime_entry_changed), datetime);
   datetime->date_format_entry = entry;
 
   gtk_widget_show_all(datetime->date_frame);
@@ -602,6 +854,14 @@ datetime_properties_dialog(XfcePanelPlugin *plugin, t_datetime * datetime)
       G_CALLBACK(time_format_changed), datetime);
   datetime->time_format_combobox = time_combobox;
 
+  /* preview of the custom format, below its entry */
+  label = gtk_label_new(NULL);
+  gtk_label_set_xalign (GTK_LABEL (label), 1.0f);
+  gtk_label_set_justify(GTK_LABEL(label), GTK_JUSTIFY_RIGHT);
+  gtk_style_context_add_class(gtk_widget_get_style_context(label), "dim-label");
+  gtk_box_pack_end(GTK_BOX(vbox), label, FALSE, FALSE, 0);
+  datetime->time_format_preview = label;
+
   /* format entry */
   entry = gtk_entry_new();
   gtk_entry_set_text(GTK_ENTRY(entry), datetime->time_format);
@@ -609,14 +869,38 @@ datetime_properties_dialog(XfcePanelPlugin *plugin, t_datetime * datetime)
   gtk_box_pack_end(GTK_BOX(vbox), entry, FALSE, FALSE, 0);
   g_signal_connect (G_OBJECT(entry), "focus-out-event",
                     G_CALLBACK (datetime_entry_change_cb), datetime);
+  g_signal_connect (G_OBJECT(entry), "changed",
+                    G_CALLBACK (datetime_entry_changed), datetime);
   datetime->time_format_entry = entry;
 
   gtk_widget_show_all(datetime->time_frame);
 
+  /*
+   * Statistics frame
+   */
+  frame = get_frame_box(_("Statistics"), &bin);
+  gtk_box_pack_start(GTK_BOX(gtk_dialog_get_content_area(GTK_DIALOG(dlg))), frame,
+      FALSE, FALSE, 0);
+
+  /* what this instance costs, refreshed while the dialog is open */
+  label = gtk_label_new(NULL);
+  gtk_label_set_xalign (GTK_LABEL (label), 0.0f);
+  gtk_label_set_selectable(GTK_LABEL(label), TRUE);
+  gtk_style_context_add_class(gtk_widget_get_style_context(label), "dim-label");
+  gtk_container_add(GTK_CONTAINER(bin), label);
+  datetime->stats_label = label;
+  datetime_stats_refresh(datetime);
+  datetime->stats_timeout_id = g_timeout_add_seconds(1, datetime_stats_refresh, datetime);
+
+  gtk_widget_show_all(frame);
+
   /* We're done! */
   g_signal_connect(dlg, "response",
       G_CALLBACK(datetime_dialog_response), datetime);
 
+  /* the labels added to it keep the size group */
+  g_object_unref(sg);
+
   /* set sensitivity for all widgets */
   datetime_layout_changed(GTK_COMBO_BOX(layout_combobox), datetime);
   date_format_changed(GTK_COMBO_BOX(date_combobox), datetime);
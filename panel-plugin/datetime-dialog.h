@@ -21,6 +21,8 @@
 #ifndef _DATETIME_DIALOG_H
 #define _DATETIME_DIALOG_H	1
 
+#include "datetime.h"
+
 void
 datetime_properties_dialog(XfcePanelPlugin *plugin, t_datetime * datetime);
 
@@ -0,0 +1,540 @@
+/*  $Id$
+ *
+ *  Copyright (C) 2003 Choe Hwanjin(krisna@kldp.org)
+ *  Copyright (c) 2006 Remco den Breeje <remco@sx.mine.nu>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+/* local includes */
+#include <string.h>
+
+/* xfce includes */
+#include <libxfce4util/libxfce4util.h>
+
+#include "datetime-display.h"
+
+typedef struct {
+  PangoLayout *layout;          /* reused for every text of the line */
+  gchar *text;                  /* shown by layout, NULL if none yet */
+  gchar *font_name;             /* font currently applied, NULL for the theme's */
+  PangoFontDescription *font;   /* font_name parsed, or NULL */
+  gint width;                   /* logical size of text in pixels */
+  gint height;
+  gint reserved_width;          /* room kept for the widest text */
+} t_display_line;
+
+/*
+ * The lines are laid out in a frame that is rotated on vertical panels:
+ * x runs along the text, y across the lines.
+ */
+struct _t_datetime_display {
+  GtkWidget *widget;
+  t_display_line lines[DATETIME_DISPLAY_LINES];
+  guint order[DATETIME_DISPLAY_LINES];  /* lines shown, first to last */
+  guint n_lines;
+  gboolean vertical;
+};
+
+static void datetime_display_get_frame(const t_datetime_display *display,
+                                       gint *along, gint *across)
+{
+  gint width = gtk_widget_get_allocated_width(display->widget);
+  gint height = gtk_widget_get_allocated_height(display->widget);
+
+  *along = display->vertical ? height : width;
+  *across = display->vertical ? width : height;
+}
+
+/*
+ * position of line among the lines shown, or -1 if it is hidden
+ */
+static gint datetime_display_find(const t_datetime_display *display, guint line)
+{
+  guint i;
+
+  for (i = 0; i < display->n_lines; i++)
+  {
+    if (display->order[i] == line)
+      return i;
+  }
+
+  return -1;
+}
+
+/*
+ * Where the text of the shown line at position i starts in the frame;
+ * like a homogeneous box, spare room is shared out evenly between the lines
+ * and each text is centered in its part.
+ */
+static void datetime_display_get_origin(const t_datetime_display *display,
+                                        guint i, gint *x, gint *y)
+{
+  const t_display_line *line = &display->lines[display->order[i]];
+  gint along, across;
+  gint total = 0;
+  gint extra;
+  guint j;
+
+  datetime_display_get_frame(display, &along, &across);
+
+  for (j = 0; j < display->n_lines; j++)
+    total += display->lines[display->order[j]].height;
+  extra = MAX(across - total, 0) / MAX(display->n_lines, 1);
+
+  *y = extra / 2;
+  for (j = 0; j < i; j++)
+    *y += display->lines[display->order[j]].height + extra;
+  *x = (along - line->width) / 2;
+}
+
+/*
+ * invalidate a rectangle of the frame; on vertical panels the frame's
+ * x runs down the widget and its y from the right edge to the left
+ */
+static void datetime_display_queue_draw(t_datetime_display *display,
+                                        gint x, gint y,
+                                        gint width, gint height)
+{
+  gint along, across;
+
+  if (!display->vertical)
+  {
+    gtk_widget_queue_draw_area(display->widget, x, y, width, height);
+    return;
+  }
+
+  datetime_display_get_frame(display, &along, &across);
+  gtk_widget_queue_draw_area(display->widget, across - y - height, x, height, width);
+}
+
+/*
+ * Name the widget after the text shown, for screen readers, like a
+ * label would be named.
+ */
+static void datetime_display_update_accessible(t_datetime_display *display)
+{
+  const gchar *text;
+  GString *name;
+  guint i;
+
+  name = g_string_new(NULL);
+  for (i = 0; i < display->n_lines; i++)
+  {
+    text = display->lines[display->order[i]].text;
+    if (text == NULL || *text == '\0')
+      continue;
+
+    if (name->len > 0)
+      g_string_append_c(name, '\n');
+    g_string_append(name, text);
+  }
+
+  atk_object_set_name(gtk_widget_get_accessible(display->widget), name->str);
+  g_string_free(name, TRUE);
+}
+
+/*
+ * request the room of the widest shown line and all their heights
+ */
+static void datetime_display_update_size(t_datetime_display *display)
+{
+  const t_display_line *line;
+  gint along = 0, across = 0;
+  guint i;
+
+  for (i = 0; i < display->n_lines; i++)
+  {
+    line = &display->lines[display->order[i]];
+    along = MAX(along, MAX(line->width, line->reserved_width));
+    across += line->height;
+  }
+
+  if (display->vertical)
+    gtk_widget_set_size_request(display->widget, across, along);
+  else
+    gtk_widget_set_size_request(display->widget, along, across);
+}
+
+/*
+ * the line's font on top of the theme's
+ */
+static void datetime_display_apply_font(t_datetime_display *display,
+                                        const t_display_line *line,
+                                        PangoLayout *layout)
+{
+  PangoContext *context = gtk_widget_get_pango_context(display->widget);
+  PangoFontDescription *font;
+
+  font = pango_font_description_copy(pango_context_get_font_description(context));
+  if (line->font != NULL)
+    pango_font_description_merge(font, line->font, TRUE);
+
+  pango_layout_set_font_description(layout, font);
+  pango_font_description_free(font);
+}
+
+static void datetime_display_relayout(t_datetime_display *display)
+{
+  t_display_line *line;
+  guint i;
+
+  for (i = 0; i < DATETIME_DISPLAY_LINES; i++)
+  {
+    line = &display->lines[i];
+    pango_layout_context_changed(line->layout);
+    datetime_display_apply_font(display, line, line->layout);
+    pango_layout_get_pixel_size(line->layout, &line->width, &line->height);
+  }
+
+  datetime_display_update_size(display);
+  gtk_widget_queue_draw(display->widget);
+}
+
+/*
+ * Whether byte offsets of the layout map to x positions in order:
+ * a single line of left-to-right text.
+ */
+static gboolean datetime_display_is_simple(PangoLayout *layout)
+{
+  PangoLayoutLine *layout_line;
+  PangoLayoutRun *run;
+  GSList *li;
+
+  if (pango_layout_get_line_count(layout) != 1)
+    return FALSE;
+
+  layout_line = pango_layout_get_line_readonly(layout, 0);
+  for (li = layout_line->runs; li != NULL; li = li->next)
+  {
+    run = li->data;
+    if (run->item->analysis.level % 2 != 0)
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+/*
+ * Horizontal extent in pixels of the glyphs from byte start to byte end,
+ * widened by how far glyphs may ink outside their logical box.
+ */
+static void datetime_display_get_range(PangoLayout *layout,
+                                       gsize start, gsize end,
+                                       gint *x0, gint *x1, gint *pad)
+{
+  PangoRectangle ink, logical, pos;
+  gsize len = strlen(pango_layout_get_text(layout));
+
+  pango_layout_get_pixel_extents(layout, &ink, &logical);
+  *pad = MAX(1, MAX(MAX(logical.x - ink.x, ink.x + ink.width - logical.x - logical.width),
+                    MAX(logical.y - ink.y, ink.y + ink.height - logical.y - logical.height)));
+
+  *x0 = *x1 = logical.x + logical.width;
+  if (start < len)
+  {
+    pango_layout_index_to_pos(layout, start, &pos);
+    *x0 = PANGO_PIXELS_FLOOR(pos.x);
+  }
+  if (end < len)
+  {
+    pango_layout_index_to_pos(layout, end, &pos);
+    *x1 = PANGO_PIXELS_CEIL(pos.x);
+  }
+}
+
+static gboolean datetime_display_draw(GtkWidget *widget, cairo_t *cr,
+                                      t_datetime_display *display)
+{
+  GtkStyleContext *context = gtk_widget_get_style_context(widget);
+  const t_display_line *line;
+  gint x, y;
+  guint i;
+
+  cairo_save(cr);
+
+  /* read top to bottom on vertical panels, as the rotated labels did */
+  if (display->vertical)
+  {
+    cairo_translate(cr, gtk_widget_get_allocated_width(widget), 0);
+    cairo_rotate(cr, G_PI / 2);
+  }
+
+  for (i = 0; i < display->n_lines; i++)
+  {
+    line = &display->lines[display->order[i]];
+    if (line->text == NULL)
+      continue;
+
+    datetime_display_get_origin(display, i, &x, &y);
+    pango_cairo_update_layout(cr, line->layout);
+    gtk_render_layout(context, cr, x, y, line->layout);
+  }
+
+  cairo_restore(cr);
+
+  return FALSE;
+}
+
+static void datetime_display_style_updated(GtkWidget *widget,
+                                           t_datetime_display *display)
+{
+  /* the theme's font may have changed */
+  datetime_display_relayout(display);
+}
+
+t_datetime_display * datetime_display_new(void)
+{
+  t_datetime_display *display;
+  t_display_line *line;
+  guint i;
+
+  display = g_slice_new0(t_datetime_display);
+  display->widget = g_object_ref_sink(gtk_drawing_area_new());
+
+  for (i = 0; i < DATETIME_DISPLAY_LINES; i++)
+  {
+    line = &display->lines[i];
+    line->layout = gtk_widget_create_pango_layout(display->widget, NULL);
+    pango_layout_set_alignment(line->layout, PANGO_ALIGN_CENTER);
+  }
+  datetime_display_relayout(display);
+
+  /* drawn text isn't seen by screen readers, present it as a label */
+  atk_object_set_role(gtk_widget_get_accessible(display->widget), ATK_ROLE_LABEL);
+
+  g_signal_connect(display->widget, "draw",
+      G_CALLBACK(datetime_display_draw), display);
+  g_signal_connect(display->widget, "style-updated",
+      G_CALLBACK(datetime_display_style_updated), display);
+
+  return display;
+}
+
+/*
+ * free the display; its widget is only gone once its parent lets go of it
+ */
+void datetime_display_free(t_datetime_display *display)
+{
+  t_display_line *line;
+  guint i;
+
+  if (display == NULL)
+    return;
+
+  g_signal_handlers_disconnect_by_data(display->widget, display);
+
+  for (i = 0; i < DATETIME_DISPLAY_LINES; i++)
+  {
+    line = &display->lines[i];
+    g_object_unref(line->layout);
+    g_free(line->text);
+    g_free(line->font_name);
+    if (line->font != NULL)
+      pango_font_description_free(line->font);
+  }
+
+  g_object_unref(display->widget);
+  g_slice_free(t_datetime_display, display);
+}
+
+GtkWidget * datetime_display_get_widget(const t_datetime_display *display)
+{
+  return display->widget;
+}
+
+/*
+ * show n_lines of the lines, in the given order
+ */
+void datetime_display_set_lines(t_datetime_display *display,
+                                const guint *lines, guint n_lines)
+{
+  display->n_lines = MIN(n_lines, DATETIME_DISPLAY_LINES);
+  memcpy(display->order, lines, display->n_lines * sizeof(guint));
+
+  datetime_display_update_accessible(display);
+  datetime_display_update_size(display);
+  gtk_widget_queue_draw(display->widget);
+}
+
+void datetime_display_set_vertical(t_datetime_display *display,
+                                   gboolean vertical)
+{
+  if (display->vertical == vertical)
+    return;
+
+  display->vertical = vertical;
+  datetime_display_update_size(display);
+  gtk_widget_queue_draw(display->widget);
+}
+
+/*
+ * Show text on line, taking ownership of it; returns whether it differs
+ * from the text shown before. If the text keeps its size, only the glyphs
+ * between the unchanged start and end are redrawn.
+ */
+gboolean datetime_display_set_text(t_datetime_display *display,
+                                   guint line_nr, gchar *text)
+{
+  t_display_line *line = &display->lines[line_nr];
+  gint old_width = line->width;
+  gint old_height = line->height;
+  gint old_x0 = 0, old_x1 = 0, old_pad = 0;
+  gint x0, x1, pad;
+  gint i, x, y, along, across;
+  gsize old_len, len;
+  gsize prefix = 0, suffix = 0;
+  gboolean simple;
+
+  if (g_strcmp0(line->text, text) == 0)
+  {
+    g_free(text);
+    return FALSE;
+  }
+
+  /* the bytes both texts start and end with, cut at whole characters */
+  old_len = (line->text != NULL) ? strlen(line->text) : 0;
+  len = strlen(text);
+  if (line->text != NULL)
+  {
+    while (prefix < old_len && prefix < len && line->text[prefix] == text[prefix])
+      prefix++;
+    while (prefix > 0 && ((text[prefix] & 0xc0) == 0x80 || (line->text[prefix] & 0xc0) == 0x80))
+      prefix--;
+
+    while (suffix < old_len - prefix && suffix < len - prefix &&
+           line->text[old_len - 1 - suffix] == text[len - 1 - suffix])
+      suffix++;
+    while (suffix > 0 && (text[len - suffix] & 0xc0) == 0x80)
+      suffix--;
+  }
+
+  i = datetime_display_find(display, line_nr);
+  simple = (i >= 0 && line->text != NULL &&
+            gtk_widget_is_drawable(display->widget) &&
+            datetime_display_is_simple(line->layout));
+  if (simple)
+    datetime_display_get_range(line->layout, prefix, old_len - suffix,
+                               &old_x0, &old_x1, &old_pad);
+
+  g_free(line->text);
+  line->text = text;
+  pango_layout_set_text(line->layout, text, -1);
+  pango_layout_get_pixel_size(line->layout, &line->width, &line->height);
+
+  if (i >= 0)
+    datetime_display_update_accessible(display);
+
+  if (i < 0 || !gtk_widget_is_drawable(display->widget))
+  {
+    datetime_display_update_size(display);
+    return TRUE;
+  }
+
+  if (line->height != old_height)
+  {
+    datetime_display_update_size(display);
+    gtk_widget_queue_draw(display->widget);
+    return TRUE;
+  }
+
+  /* the text is centered, so it all moves if its width changes */
+  if (line->width != old_width || !simple || !datetime_display_is_simple(line->layout))
+  {
+    datetime_display_update_size(display);
+    datetime_display_get_origin(display, i, &x, &y);
+    datetime_display_get_frame(display, &along, &across);
+    datetime_display_queue_draw(display, 0, y, along, line->height);
+    return TRUE;
+  }
+
+  datetime_display_get_range(line->layout, prefix, len - suffix, &x0, &x1, &pad);
+  x0 = MIN(x0, old_x0);
+  x1 = MAX(x1, old_x1);
+  pad = MAX(pad, old_pad);
+
+  datetime_display_get_origin(display, i, &x, &y);
+  datetime_display_queue_draw(display, x + x0 - pad, y - pad,
+                              x1 - x0 + 2 * pad, line->height + 2 * pad);
+
+  return TRUE;
+}
+
+/*
+ * text shown by line, NULL if none was set yet
+ */
+const gchar * datetime_display_get_text(const t_datetime_display *display,
+                                        guint line)
+{
+  return display->lines[line].text;
+}
+
+/*
+ * Set the font of a line from its name, or the theme's if font_name
+ * is NULL; setting the font it already has costs a string compare.
+ */
+void datetime_display_set_font(t_datetime_display *display,
+                               guint line_nr, const gchar *font_name)
+{
+  t_display_line *line = &display->lines[line_nr];
+
+  if (g_strcmp0(line->font_name, font_name) == 0)
+    return;
+
+  g_free(line->font_name);
+  line->font_name = g_strdup(font_name);
+  if (line->font != NULL)
+    pango_font_description_free(line->font);
+  line->font = (font_name != NULL) ? pango_font_description_from_string(font_name) : NULL;
+
+  datetime_display_apply_font(display, line, line->layout);
+  pango_layout_get_pixel_size(line->layout, &line->width, &line->height);
+
+  datetime_display_update_size(display);
+  gtk_widget_queue_draw(display->widget);
+}
+
+/*
+ * a new layout in the font of line, e.g. to measure texts; unref it
+ */
+PangoLayout * datetime_display_create_layout(t_datetime_display *display,
+                                             guint line)
+{
+  PangoLayout *layout;
+
+  layout = gtk_widget_create_pango_layout(display->widget, NULL);
+  pango_layout_set_alignment(layout, PANGO_ALIGN_CENTER);
+  datetime_display_apply_font(display, &display->lines[line], layout);
+
+  return layout;
+}
+
+/*
+ * Keep room for width pixels of text on line, whatever it shows,
+ * so the panel doesn't change size with the digits.
+ */
+void datetime_display_reserve_width(t_datetime_display *display,
+                                    guint line, gint width)
+{
+  if (display->lines[line].reserved_width == width)
+    return;
+
+  display->lines[line].reserved_width = width;
+  datetime_display_update_size(display);
+}
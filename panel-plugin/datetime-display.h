@@ -0,0 +1,77 @@
+/*  $Id$
+ *
+ *  Copyright (C) 2003 Choe Hwanjin(krisna@kldp.org)
+ *  Copyright (c) 2006 Remco den Breeje <remco@sx.mine.nu>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef DATETIME_DISPLAY_H
+#define DATETIME_DISPLAY_H
+
+#include <gtk/gtk.h>
+
+#define DATETIME_DISPLAY_LINES 3
+
+/*
+ * The lines of text shown in the panel, drawn by a single widget.
+ * Every line keeps one PangoLayout for good; when its text changes,
+ * only the glyphs that differ are redrawn, e.g. the last digits of the time.
+ * On vertical panels the lines are rotated to read bottom to top.
+ */
+typedef struct _t_datetime_display t_datetime_display;
+
+t_datetime_display *
+datetime_display_new(void);
+
+void
+datetime_display_free(t_datetime_display *display);
+
+GtkWidget *
+datetime_display_get_widget(const t_datetime_display *display);
+
+void
+datetime_display_set_lines(t_datetime_display *display,
+    const guint *lines,
+    guint n_lines);
+
+void
+datetime_display_set_vertical(t_datetime_display *display,
+    gboolean vertical);
+
+gboolean
+datetime_display_set_text(t_datetime_display *display,
+    guint line,
+    gchar *text);
+
+const gchar *
+datetime_display_get_text(const t_datetime_display *display,
+    guint line);
+
+void
+datetime_display_set_font(t_datetime_display *display,
+    guint line,
+    const gchar *font_name);
+
+PangoLayout *
+datetime_display_create_layout(t_datetime_display *display,
+    guint line);
+
+void
+datetime_display_reserve_width(t_datetime_display *display,
+    guint line,
+    gint width);
+
+#endif /* datetime-display.h */
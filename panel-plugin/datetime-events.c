@@ -0,0 +1,1493 @@
+/*  $Id$
+ *
+ *  Copyright (C) 2003 Choe Hwanjin(krisna@kldp.org)
+ *  Copyright (c) 2006 Remco den Breeje <remco@sx.mine.nu>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+/* local includes */
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+/* xfce includes */
+#include <libxfce4util/libxfce4util.h>
+
+#include "datetime-zone.h"
+#include "datetime-events.h"
+
+/* julian day, as GDate counts them, of 1970-01-01 */
+#define DATETIME_EVENTS_EPOCH_DAY 719163
+
+/* longest span indexed for an event, in days */
+#define DATETIME_EVENTS_MAX_DAYS 366
+
+/* periods a recurrence rule may walk through for one month */
+#define DATETIME_EVENTS_MAX_STEPS 100000
+
+#define DATETIME_EVENTS_CACHE_MAGIC 0x45544458  /* "XDTE" */
+#define DATETIME_EVENTS_CACHE_VERSION 1
+
+typedef enum
+{
+  FREQ_NONE = 0,
+  FREQ_DAILY,
+  FREQ_WEEKLY,
+  FREQ_MONTHLY,
+  FREQ_YEARLY
+} t_freq;
+
+/* day and time of the event are in UTC rather than on its own wall clock */
+#define EVENT_UTC (1 << 0)
+
+typedef struct {
+  guint32 day;      /* julian day of the start */
+  gint32 time;      /* seconds after the start of day, -1 for all-day events */
+  guint32 summary;  /* offset into the strings */
+  guint16 days;     /* days the event covers, at least 1 */
+  guint16 flags;
+  guint32 rule;     /* index + 1 into the rules, 0 if the event doesn't recur */
+} t_event;
+
+/*
+ * An RRULE, reduced to the parts calendars commonly export;
+ * BYSETPOS, BYWEEKNO, BYYEARDAY and WKST are ignored.
+ */
+typedef struct {
+  guint8 freq;
+  guint8 n_byday;
+  guint8 n_bymonthday;
+  guint8 reserved;
+  guint16 interval;
+  guint16 bymonth;         /* bit per month, 1 << 1 for January; 0 for any */
+  guint32 count;           /* 0 for no limit */
+  guint32 until;           /* julian day, 0 for no limit */
+  gint8 byday_nth[7];      /* 0 for every such weekday of the period */
+  guint8 byday_wday[7];    /* GDateWeekday */
+  gint8 bymonthday[4];
+  guint32 exdates;         /* first excluded day in the exdates */
+  guint32 n_exdates;
+} t_rule;
+
+/*
+ * The events of one file; never changed once loaded, so the worker
+ * thread may look at the files loaded before.
+ */
+typedef struct {
+  gint ref_count;
+  gchar *path;
+  gint64 mtime;
+  gint64 size;
+  GArray *events;     /* t_event that don't recur, sorted by day */
+  GArray *recurring;  /* t_event with a rule */
+  GArray *rules;      /* t_rule */
+  GArray *exdates;    /* guint32 julian days, sorted per rule */
+  GString *strings;   /* summaries, nul-terminated */
+  guint32 max_days;   /* longest event of events */
+} t_events_file;
+
+/* header of a file's cache, followed by its arrays and strings */
+typedef struct {
+  guint32 magic;
+  guint32 version;
+  guint32 event_size;
+  guint32 rule_size;
+  gint64 mtime;
+  gint64 size;
+  guint32 n_events;
+  guint32 n_recurring;
+  guint32 n_rules;
+  guint32 n_exdates;
+  guint32 strings_len;
+  guint32 max_days;
+} t_cache_header;
+
+/* a recurring event starting on day */
+typedef struct {
+  guint32 day;
+  const t_event *event;
+  const gchar *summary;
+} t_occurrence;
+
+typedef struct {
+  gchar **paths;
+  GPtrArray *old;     /* t_events_file loaded before, reused if unchanged */
+} t_events_load;
+
+struct _t_datetime_events {
+  gchar **paths;
+  GPtrArray *files;       /* t_events_file */
+  GHashTable *months;     /* year * 12 + month -> GArray of t_occurrence */
+  GCancellable *cancellable;  /* of the running load, NULL if none */
+  gboolean reload;        /* load again once the running load is done */
+  t_datetime_events_func func;
+  gpointer user_data;
+};
+
+typedef void (*t_events_day_func)(guint mday,
+                                  gint32 time,
+                                  const gchar *summary,
+                                  gpointer user_data);
+
+static guint32 datetime_events_julian(guint year, guint month, guint mday)
+{
+  GDate date;
+
+  if (!g_date_valid_dmy(mday, month, year))
+    return 0;
+
+  g_date_clear(&date, 1);
+  g_date_set_dmy(&date, mday, month, year);
+  return g_date_get_julian(&date);
+}
+
+static void datetime_events_dmy(guint32 day, GDate *date)
+{
+  g_date_clear(date, 1);
+  g_date_set_julian(date, day);
+}
+
+static t_events_file * datetime_events_file_new(const gchar *path,
+                                                const GStatBuf *st)
+{
+  t_events_file *file;
+
+  file = g_slice_new0(t_events_file);
+  file->ref_count = 1;
+  file->path = g_strdup(path);
+  file->mtime = st->st_mtime;
+  file->size = st->st_size;
+  file->events = g_array_new(FALSE, FALSE, sizeof(t_event));
+  file->recurring = g_array_new(FALSE, FALSE, sizeof(t_event));
+  file->rules = g_array_new(FALSE, FALSE, sizeof(t_rule));
+  file->exdates = g_array_new(FALSE, FALSE, sizeof(guint32));
+  file->strings = g_string_new(NULL);
+
+  return file;
+}
+
+static t_events_file * datetime_events_file_ref(t_events_file *file)
+{
+  g_atomic_int_inc(&file->ref_count);
+  return file;
+}
+
+static void datetime_events_file_unref(t_events_file *file)
+{
+  if (!g_atomic_int_dec_and_test(&file->ref_count))
+    return;
+
+  g_free(file->path);
+  g_array_unref(file->events);
+  g_array_unref(file->recurring);
+  g_array_unref(file->rules);
+  g_array_unref(file->exdates);
+  g_string_free(file->strings, TRUE);
+  g_slice_free(t_events_file, file);
+}
+
+
+
+/*
+ * iCalendar parsing
+ */
+
+typedef struct {
+  t_events_file *file;
+  gboolean in_event;
+  gint depth;             /* of components nested in the event, e.g. VALARM */
+
+  /* the event being read */
+  GString *summary;
+  gchar *uid;
+  guint32 start_day;      /* 0 if none */
+  gint32 start_time;
+  gboolean start_utc;
+  guint32 end_day;        /* 0 if none */
+  gint32 end_time;
+  gint64 duration;        /* seconds, -1 if none */
+  gboolean cancelled;
+  gboolean has_rule;
+  t_rule rule;
+  GArray *exdates;
+  guint32 recurrence_day; /* of the instance a modified event replaces */
+
+  GPtrArray *rule_exdates;  /* GArray of excluded days per rule */
+  GHashTable *uids;       /* uid -> rule index + 1 */
+  GPtrArray *overrides;   /* uid, then day as pointer, of modified instances */
+} t_ics_parser;
+
+/*
+ * Parse "YYYYMMDD" or "YYYYMMDDTHHMMSS[Z]"; time is -1 for dates.
+ * Times with a TZID are taken on their own wall clock.
+ */
+static gboolean datetime_events_parse_time(const gchar *value,
+                                           guint32 *day,
+                                           gint32 *time,
+                                           gboolean *utc)
+{
+  guint year, month, mday, hour = 0, min = 0, sec = 0;
+  gsize len = strlen(value);
+
+  *time = -1;
+  *utc = FALSE;
+
+  if (len < 8 || sscanf(value, "%4u%2u%2u", &year, &month, &mday) != 3)
+    return FALSE;
+
+  *day = datetime_events_julian(year, month, mday);
+  if (*day == 0)
+    return FALSE;
+
+  if (len >= 15 && value[8] == 'T' &&
+      sscanf(value + 9, "%2u%2u%2u", &hour, &min, &sec) == 3 &&
+      hour < 24 && min < 60 && sec <= 60)
+  {
+    *time = hour * 3600 + min * 60 + MIN(sec, 59);
+    *utc = (value[15] == 'Z');
+  }
+
+  return TRUE;
+}
+
+/*
+ * seconds of a DURATION such as "P1D", "PT1H30M" or "P2W"
+ */
+static gint64 datetime_events_parse_duration(const gchar *value)
+{
+  gint64 seconds = 0, number;
+  gchar *end;
+
+  if (*value == '+' || *value == '-')
+    value++;
+  if (*value++ != 'P')
+    return -1;
+
+  while (*value != '\0')
+  {
+    if (*value == 'T')
+    {
+      value++;
+      continue;
+    }
+
+    number = g_ascii_strtoll(value, &end, 10);
+    if (end == value)
+      return -1;
+
+    switch (*end)
+    {
+      case 'W': seconds += number * 7 * 86400; break;
+      case 'D': seconds += number * 86400; break;
+      case 'H': seconds += number * 3600; break;
+      case 'M': seconds += number * 60; break;
+      case 'S': seconds += number; break;
+      default: return -1;
+    }
+    value = end + 1;
+  }
+
+  return seconds;
+}
+
+static gboolean datetime_events_parse_weekday(const gchar *name, guint8 *wday)
+{
+  static const gchar *names[] = { "MO", "TU", "WE", "TH", "FR", "SA", "SU" };
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS(names); i++)
+  {
+    if (strcmp(name, names[i]) == 0)
+    {
+      *wday = G_DATE_MONDAY + i;
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+static gboolean datetime_events_parse_rule(const gchar *value, t_rule *rule)
+{
+  gchar **parts, **items, *end;
+  const gchar *item;
+  gboolean utc;
+  gint32 time;
+  gint64 number;
+  guint i, j;
+
+  memset(rule, 0, sizeof(t_rule));
+  rule->interval = 1;
+
+  parts = g_strsplit(value, ";", -1);
+  for (i = 0; parts[i] != NULL; i++)
+  {
+    if (g_str_has_prefix(parts[i], "FREQ="))
+    {
+      item = parts[i] + 5;
+      if (strcmp(item, "DAILY") == 0)
+        rule->freq = FREQ_DAILY;
+      else if (strcmp(item, "WEEKLY") == 0)
+        rule->freq = FREQ_WEEKLY;
+      else if (strcmp(item, "MONTHLY") == 0)
+        rule->freq = FREQ_MONTHLY;
+      else if (strcmp(item, "YEARLY") == 0)
+        rule->freq = FREQ_YEARLY;
+    }
+    else if (g_str_has_prefix(parts[i], "INTERVAL="))
+      rule->interval = CLAMP(atoi(parts[i] + 9), 1, G_MAXUINT16);
+    else if (g_str_has_prefix(parts[i], "COUNT="))
+      rule->count = MAX(atoi(parts[i] + 6), 0);
+    else if (g_str_has_prefix(parts[i], "UNTIL="))
+    {
+      if (!datetime_events_parse_time(parts[i] + 6, &rule->until, &time, &utc))
+        rule->until = 0;
+    }
+    else if (g_str_has_prefix(parts[i], "BYMONTH="))
+    {
+      items = g_strsplit(parts[i] + 8, ",", -1);
+      for (j = 0; items[j] != NULL; j++)
+      {
+        number = atoi(items[j]);
+        if (number >= 1 && number <= 12)
+          rule->bymonth |= 1 << number;
+      }
+      g_strfreev(items);
+    }
+    else if (g_str_has_prefix(parts[i], "BYMONTHDAY="))
+    {
+      items = g_strsplit(parts[i] + 11, ",", -1);
+      for (j = 0; items[j] != NULL && rule->n_bymonthday < G_N_ELEMENTS(rule->bymonthday); j++)
+      {
+        number = atoi(items[j]);
+        if (number != 0 && number >= -31 && number <= 31)
+          rule->bymonthday[rule->n_bymonthday++] = number;
+      }
+      g_strfreev(items);
+    }
+    else if (g_str_has_prefix(parts[i], "BYDAY="))
+    {
+      items = g_strsplit(parts[i] + 6, ",", -1);
+      for (j = 0; items[j] != NULL && rule->n_byday < G_N_ELEMENTS(rule->byday_wday); j++)
+      {
+        number = g_ascii_strtoll(items[j], &end, 10);
+        if (number < -53 || number > 53 ||
+            !datetime_events_parse_weekday(end, &rule->byday_wday[rule->n_byday]))
+          continue;
+        rule->byday_nth[rule->n_byday++] = number;
+      }
+      g_strfreev(items);
+    }
+  }
+  g_strfreev(parts);
+
+  return rule->freq != FREQ_NONE;
+}
+
+/*
+ * undo the escaping of TEXT values, putting line breaks on one line
+ */
+static void datetime_events_append_text(GString *str, const gchar *value)
+{
+  for (; *value != '\0'; value++)
+  {
+    if (*value != '\\' || value[1] == '\0')
+    {
+      g_string_append_c(str, *value);
+      continue;
+    }
+
+    value++;
+    g_string_append_c(str, (*value == 'n' || *value == 'N') ? ' ' : *value);
+  }
+}
+
+static void datetime_events_parser_reset(t_ics_parser *parser)
+{
+  g_string_truncate(parser->summary, 0);
+  g_free(parser->uid);
+  parser->uid = NULL;
+  parser->start_day = 0;
+  parser->end_day = 0;
+  parser->duration = -1;
+  parser->cancelled = FALSE;
+  parser->has_rule = FALSE;
+  g_array_set_size(parser->exdates, 0);
+  parser->recurrence_day = 0;
+}
+
+static void datetime_events_parser_end_event(t_ics_parser *parser)
+{
+  t_events_file *file = parser->file;
+  t_event event;
+  gint64 days = 1;
+  GArray *exdates;
+
+  if (parser->start_day == 0 || parser->cancelled)
+    return;
+
+  event.day = parser->start_day;
+  event.time = parser->start_time;
+  event.flags = parser->start_utc ? EVENT_UTC : 0;
+  event.rule = 0;
+
+  /* DTEND is exclusive, so an event ending at midnight doesn't cover that day */
+  if (parser->end_day != 0)
+  {
+    days = (gint64) parser->end_day - parser->start_day;
+    if (event.time >= 0 && parser->end_time > 0)
+      days++;
+  }
+  else if (parser->duration > 0)
+  {
+    if (event.time < 0)
+      days = parser->duration / 86400;
+    else
+      days = (event.time + parser->duration - 1) / 86400 + 1;
+  }
+  event.days = CLAMP(days, 1, DATETIME_EVENTS_MAX_DAYS);
+
+  event.summary = file->strings->len;
+  g_string_append_len(file->strings, parser->summary->str, parser->summary->len + 1);
+
+  /* a modified instance of a recurring event replaces the original one */
+  if (parser->recurrence_day != 0 && parser->uid != NULL)
+  {
+    g_ptr_array_add(parser->overrides, g_strdup(parser->uid));
+    g_ptr_array_add(parser->overrides, GUINT_TO_POINTER(parser->recurrence_day));
+  }
+
+  if (!parser->has_rule)
+  {
+    g_array_append_val(file->events, event);
+    file->max_days = MAX(file->max_days, event.days);
+    return;
+  }
+
+  g_array_append_val(file->rules, parser->rule);
+  event.rule = file->rules->len;
+  g_array_append_val(file->recurring, event);
+
+  exdates = g_array_new(FALSE, FALSE, sizeof(guint32));
+  g_array_append_vals(exdates, parser->exdates->data, parser->exdates->len);
+  g_ptr_array_add(parser->rule_exdates, exdates);
+
+  if (parser->uid != NULL)
+    g_hash_table_insert(parser->uids, g_strdup(parser->uid), GUINT_TO_POINTER(event.rule));
+}
+
+static void datetime_events_parser_line(t_ics_parser *parser, gchar *line)
+{
+  gchar *value, *params, *p;
+  gchar **dates;
+  gboolean quoted = FALSE;
+  gboolean utc;
+  gint32 time;
+  guint32 day;
+  guint i;
+
+  /* NAME;PARAM=...;PARAM="...:...":VALUE */
+  for (value = line; *value != '\0'; value++)
+  {
+    if (*value == '"')
+      quoted = !quoted;
+    else if (*value == ':' && !quoted)
+      break;
+  }
+  if (*value == '\0')
+    return;
+  *value++ = '\0';
+
+  params = strchr(line, ';');
+  if (params != NULL)
+    *params++ = '\0';
+  for (p = line; *p != '\0'; p++)
+    *p = g_ascii_toupper(*p);
+
+  if (strcmp(line, "BEGIN") == 0)
+  {
+    if (parser->in_event)
+      parser->depth++;
+    else if (g_ascii_strcasecmp(value, "VEVENT") == 0)
+    {
+      parser->in_event = TRUE;
+      datetime_events_parser_reset(parser);
+    }
+    return;
+  }
+
+  if (!parser->in_event)
+    return;
+
+  if (strcmp(line, "END") == 0)
+  {
+    if (parser->depth > 0)
+      parser->depth--;
+    else
+    {
+      parser->in_event = FALSE;
+      datetime_events_parser_end_event(parser);
+    }
+    return;
+  }
+
+  /* properties of alarms and the like */
+  if (parser->depth > 0)
+    return;
+
+  if (strcmp(line, "SUMMARY") == 0)
+  {
+    g_string_truncate(parser->summary, 0);
+    datetime_events_append_text(parser->summary, value);
+  }
+  else if (strcmp(line, "UID") == 0)
+  {
+    g_free(parser->uid);
+    parser->uid = g_strdup(value);
+  }
+  else if (strcmp(line, "DTSTART") == 0)
+  {
+    if (!datetime_events_parse_time(value, &parser->start_day,
+                                    &parser->start_time, &parser->start_utc))
+      parser->start_day = 0;
+  }
+  else if (strcmp(line, "DTEND") == 0)
+  {
+    if (!datetime_events_parse_time(value, &parser->end_day, &parser->end_time, &utc))
+      parser->end_day = 0;
+  }
+  else if (strcmp(line, "DURATION") == 0)
+    parser->duration = datetime_events_parse_duration(value);
+  else if (strcmp(line, "STATUS") == 0)
+    parser->cancelled = (g_ascii_strcasecmp(value, "CANCELLED") == 0);
+  else if (strcmp(line, "RRULE") == 0)
+    parser->has_rule = datetime_events_parse_rule(value, &parser->rule);
+  else if (strcmp(line, "EXDATE") == 0)
+  {
+    dates = g_strsplit(value, ",", -1);
+    for (i = 0; dates[i] != NULL; i++)
+    {
+      if (datetime_events_parse_time(dates[i], &day, &time, &utc))
+        g_array_append_val(parser->exdates, day);
+    }
+    g_strfreev(dates);
+  }
+  else if (strcmp(line, "RECURRENCE-ID") == 0)
+  {
+    if (!datetime_events_parse_time(value, &parser->recurrence_day, &time, &utc))
+      parser->recurrence_day = 0;
+  }
+}
+
+static gint datetime_events_compare_days(gconstpointer a, gconstpointer b)
+{
+  guint32 day_a = *(const guint32 *) a;
+  guint32 day_b = *(const guint32 *) b;
+
+  return (day_a > day_b) - (day_a < day_b);
+}
+
+static gint datetime_events_compare_events(gconstpointer a, gconstpointer b)
+{
+  const t_event *event_a = a;
+  const t_event *event_b = b;
+
+  if (event_a->day != event_b->day)
+    return (event_a->day > event_b->day) ? 1 : -1;
+
+  return (event_a->time > event_b->time) - (event_a->time < event_b->time);
+}
+
+/*
+ * sort the events by day and lay out the excluded days rule by rule
+ */
+static void datetime_events_parser_finish(t_ics_parser *parser)
+{
+  t_events_file *file = parser->file;
+  GArray *exdates;
+  t_rule *rule;
+  gpointer index;
+  guint i;
+
+  for (i = 0; i + 1 < parser->overrides->len; i += 2)
+  {
+    index = g_hash_table_lookup(parser->uids, g_ptr_array_index(parser->overrides, i));
+    if (index == NULL)
+      continue;
+
+    exdates = g_ptr_array_index(parser->rule_exdates, GPOINTER_TO_UINT(index) - 1);
+    g_array_append_val(exdates, g_ptr_array_index(parser->overrides, i + 1));
+  }
+
+  for (i = 0; i < file->rules->len; i++)
+  {
+    exdates = g_ptr_array_index(parser->rule_exdates, i);
+    g_array_sort(exdates, datetime_events_compare_days);
+
+    rule = &g_array_index(file->rules, t_rule, i);
+    rule->exdates = file->exdates->len;
+    rule->n_exdates = exdates->len;
+    g_array_append_vals(file->exdates, exdates->data, exdates->len);
+  }
+
+  g_array_sort(file->events, datetime_events_compare_events);
+}
+
+static t_events_file * datetime_events_parse(const gchar *path,
+                                             const GStatBuf *st)
+{
+  t_ics_parser parser = { NULL };
+  GString *line;
+  gchar *contents, *p, *end;
+  gsize length;
+  guint i;
+
+  if (!g_file_get_contents(path, &contents, &length, NULL))
+    return NULL;
+
+  parser.file = datetime_events_file_new(path, st);
+  parser.summary = g_string_new(NULL);
+  parser.exdates = g_array_new(FALSE, FALSE, sizeof(guint32));
+  parser.rule_exdates = g_ptr_array_new_with_free_func((GDestroyNotify) g_array_unref);
+  parser.uids = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+  parser.overrides = g_ptr_array_new();
+  datetime_events_parser_reset(&parser);
+
+  /* long lines are folded into ones starting with a space or tab */
+  line = g_string_new(NULL);
+  for (p = contents; p < contents + length; p = end + 1)
+  {
+    end = memchr(p, '\n', contents + length - p);
+    if (end == NULL)
+      end = contents + length;
+    if (end > p && end[-1] == '\r')
+      end[-1] = '\0';
+    *end = '\0';
+
+    if (*p == ' ' || *p == '\t')
+    {
+      g_string_append(line, p + 1);
+      continue;
+    }
+
+    if (line->len > 0)
+      datetime_events_parser_line(&parser, line->str);
+    g_string_assign(line, p);
+  }
+  if (line->len > 0)
+    datetime_events_parser_line(&parser, line->str);
+
+  datetime_events_parser_finish(&parser);
+
+  for (i = 0; i + 1 < parser.overrides->len; i += 2)
+    g_free(g_ptr_array_index(parser.overrides, i));
+  g_ptr_array_unref(parser.overrides);
+  g_hash_table_destroy(parser.uids);
+  g_ptr_array_unref(parser.rule_exdates);
+  g_array_unref(parser.exdates);
+  g_string_free(parser.summary, TRUE);
+  g_free(parser.uid);
+  g_string_free(line, TRUE);
+  g_free(contents);
+
+  return parser.file;
+}
+
+
+
+/*
+ * cache on disk
+ */
+
+static gchar * datetime_events_cache_path(const gchar *path)
+{
+  gchar *checksum, *name, *cache_path;
+
+  checksum = g_compute_checksum_for_string(G_CHECKSUM_SHA1, path, -1);
+  name = g_strconcat(checksum, ".events", NULL);
+  cache_path = g_build_filename(g_get_user_cache_dir(), "xfce4", "datetime-plugin",
+                                name, NULL);
+  g_free(name);
+  g_free(checksum);
+
+  return cache_path;
+}
+
+static void datetime_events_cache_write(const t_events_file *file)
+{
+  t_cache_header header;
+  GString *data;
+  gchar *cache_path, *dir;
+
+  header.magic = DATETIME_EVENTS_CACHE_MAGIC;
+  header.version = DATETIME_EVENTS_CACHE_VERSION;
+  header.event_size = sizeof(t_event);
+  header.rule_size = sizeof(t_rule);
+  header.mtime = file->mtime;
+  header.size = file->size;
+  header.n_events = file->events->len;
+  header.n_recurring = file->recurring->len;
+  header.n_rules = file->rules->len;
+  header.n_exdates = file->exdates->len;
+  header.strings_len = file->strings->len;
+  header.max_days = file->max_days;
+
+  data = g_string_sized_new(sizeof(header) +
+                            (file->events->len + file->recurring->len) * sizeof(t_event) +
+                            file->rules->len * sizeof(t_rule) +
+                            file->exdates->len * sizeof(guint32) + file->strings->len);
+  g_string_append_len(data, (const gchar *) &header, sizeof(header));
+  g_string_append_len(data, file->events->data, file->events->len * sizeof(t_event));
+  g_string_append_len(data, file->recurring->data, file->recurring->len * sizeof(t_event));
+  g_string_append_len(data, file->rules->data, file->rules->len * sizeof(t_rule));
+  g_string_append_len(data, file->exdates->data, file->exdates->len * sizeof(guint32));
+  g_string_append_len(data, file->strings->str, file->strings->len);
+
+  cache_path = datetime_events_cache_path(file->path);
+  dir = g_path_get_dirname(cache_path);
+
+  /* written to a temporary file first, so readers never see half of it */
+  if (g_mkdir_with_parents(dir, 0700) != 0 ||
+      !g_file_set_contents(cache_path, data->str, data->len, NULL))
+    DBG("could not write %s", cache_path);
+
+  g_free(dir);
+  g_free(cache_path);
+  g_string_free(data, TRUE);
+}
+
+static gboolean datetime_events_check_events(const t_events_file *file, GArray *events)
+{
+  const t_event *event;
+  guint i;
+
+  for (i = 0; i < events->len; i++)
+  {
+    event = &g_array_index(events, t_event, i);
+    if (event->summary >= file->strings->len || event->rule > file->rules->len ||
+        event->days == 0 || event->days > DATETIME_EVENTS_MAX_DAYS)
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+/*
+ * the cached events of path, NULL unless they were read from its current version
+ */
+static t_events_file * datetime_events_cache_read(const gchar *path,
+                                                  const GStatBuf *st)
+{
+  t_events_file *file;
+  t_cache_header header;
+  gchar *cache_path, *contents;
+  const gchar *p;
+  gsize length;
+  const t_rule *rule;
+  guint i;
+
+  cache_path = datetime_events_cache_path(path);
+  if (!g_file_get_contents(cache_path, &contents, &length, NULL))
+  {
+    g_free(cache_path);
+    return NULL;
+  }
+  g_free(cache_path);
+
+  if (length < sizeof(header))
+  {
+    g_free(contents);
+    return NULL;
+  }
+  memcpy(&header, contents, sizeof(header));
+
+  if (header.magic != DATETIME_EVENTS_CACHE_MAGIC ||
+      header.version != DATETIME_EVENTS_CACHE_VERSION ||
+      header.event_size != sizeof(t_event) || header.rule_size != sizeof(t_rule) ||
+      header.mtime != (gint64) st->st_mtime || header.size != (gint64) st->st_size ||
+      length != sizeof(header) +
+                ((gsize) header.n_events + header.n_recurring) * sizeof(t_event) +
+                (gsize) header.n_rules * sizeof(t_rule) +
+                (gsize) header.n_exdates * sizeof(guint32) + header.strings_len ||
+      (header.strings_len > 0 && contents[length - 1] != '\0'))
+  {
+    g_free(contents);
+    return NULL;
+  }
+
+  file = datetime_events_file_new(path, st);
+  file->max_days = MIN(header.max_days, DATETIME_EVENTS_MAX_DAYS);
+
+  p = contents + sizeof(header);
+  g_array_append_vals(file->events, p, header.n_events);
+  p += header.n_events * sizeof(t_event);
+  g_array_append_vals(file->recurring, p, header.n_recurring);
+  p += header.n_recurring * sizeof(t_event);
+  g_array_append_vals(file->rules, p, header.n_rules);
+  p += header.n_rules * sizeof(t_rule);
+  g_array_append_vals(file->exdates, p, header.n_exdates);
+  p += header.n_exdates * sizeof(guint32);
+  g_string_append_len(file->strings, p, header.strings_len);
+  g_free(contents);
+
+  /* a damaged cache must not send lookups out of bounds */
+  for (i = 0; i < file->rules->len; i++)
+  {
+    rule = &g_array_index(file->rules, t_rule, i);
+    if (rule->exdates > file->exdates->len ||
+        rule->n_exdates > file->exdates->len - rule->exdates ||
+        rule->n_byday > G_N_ELEMENTS(rule->byday_wday) ||
+        rule->n_bymonthday > G_N_ELEMENTS(rule->bymonthday) ||
+        rule->interval == 0)
+      break;
+  }
+  if (i < file->rules->len ||
+      !datetime_events_check_events(file, file->events) ||
+      !datetime_events_check_events(file, file->recurring))
+  {
+    datetime_events_file_unref(file);
+    return NULL;
+  }
+
+  return file;
+}
+
+
+
+/*
+ * loading in a worker thread
+ */
+
+static void datetime_events_load_free(t_events_load *load)
+{
+  g_strfreev(load->paths);
+  g_ptr_array_unref(load->old);
+  g_slice_free(t_events_load, load);
+}
+
+static void datetime_events_load_thread(GTask *task,
+                                        gpointer source_object,
+                                        gpointer task_data,
+                                        GCancellable *cancellable)
+{
+  t_events_load *load = task_data;
+  t_events_file *file, *old;
+  GPtrArray *files;
+  GStatBuf st;
+  guint i, j;
+
+  files = g_ptr_array_new_with_free_func((GDestroyNotify) datetime_events_file_unref);
+
+  for (i = 0; load->paths[i] != NULL; i++)
+  {
+    if (g_cancellable_is_cancelled(cancellable))
+      break;
+
+    if (g_stat(load->paths[i], &st) != 0)
+    {
+      DBG("%s: not found", load->paths[i]);
+      continue;
+    }
+
+    /* still the same file */
+    file = NULL;
+    for (j = 0; j < load->old->len && file == NULL; j++)
+    {
+      old = g_ptr_array_index(load->old, j);
+      if (strcmp(old->path, load->paths[i]) == 0 &&
+          old->mtime == (gint64) st.st_mtime && old->size == (gint64) st.st_size)
+        file = datetime_events_file_ref(old);
+    }
+
+    if (file == NULL)
+    {
+      file = datetime_events_cache_read(load->paths[i], &st);
+      if (file != NULL)
+        DBG("%s: %u events, %u recurring, from the cache", file->path,
+            file->events->len, file->recurring->len);
+    }
+
+    if (file == NULL)
+    {
+      file = datetime_events_parse(load->paths[i], &st);
+      if (file == NULL)
+        continue;
+
+      DBG("%s: %u events, %u recurring, parsed", file->path,
+          file->events->len, file->recurring->len);
+      datetime_events_cache_write(file);
+    }
+
+    g_ptr_array_add(files, file);
+  }
+
+  g_task_return_pointer(task, files, (GDestroyNotify) g_ptr_array_unref);
+}
+
+static void datetime_events_loaded(GObject *source_object,
+                                   GAsyncResult *result,
+                                   gpointer user_data)
+{
+  GTask *task = G_TASK(result);
+  t_datetime_events *events;
+  GPtrArray *files;
+  gboolean changed;
+  guint i;
+
+  /* events may be gone already, then the load was cancelled */
+  if (g_cancellable_is_cancelled(g_task_get_cancellable(task)))
+    return;
+
+  events = user_data;
+  files = g_task_propagate_pointer(task, NULL);
+  g_clear_object(&events->cancellable);
+
+  changed = (files->len != events->files->len);
+  for (i = 0; i < files->len && !changed; i++)
+    changed = (g_ptr_array_index(files, i) != g_ptr_array_index(events->files, i));
+
+  if (changed)
+  {
+    g_ptr_array_unref(events->files);
+    events->files = files;
+    g_hash_table_remove_all(events->months);
+    events->func(events->user_data);
+  }
+  else
+    g_ptr_array_unref(files);
+
+  if (events->reload)
+  {
+    events->reload = FALSE;
+    datetime_events_refresh(events);
+  }
+}
+
+/*
+ * Start loading the events of files, a list of paths separated by ';'.
+ * func is called once they are there, and whenever they change after
+ * datetime_events_refresh().
+ */
+t_datetime_events * datetime_events_new(const gchar *files,
+                                        t_datetime_events_func func,
+                                        gpointer user_data)
+{
+  t_datetime_events *events;
+  GPtrArray *paths;
+  gchar **parts;
+  gchar *path;
+  guint i;
+
+  events = g_slice_new0(t_datetime_events);
+  events->func = func;
+  events->user_data = user_data;
+  events->files = g_ptr_array_new_with_free_func((GDestroyNotify) datetime_events_file_unref);
+  events->months = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                         NULL, (GDestroyNotify) g_array_unref);
+
+  paths = g_ptr_array_new();
+  parts = g_strsplit(files != NULL ? files : "", ";", -1);
+  for (i = 0; parts[i] != NULL; i++)
+  {
+    path = g_strstrip(parts[i]);
+    if (*path == '\0')
+      continue;
+
+    if (path[0] == '~' && path[1] == G_DIR_SEPARATOR)
+      g_ptr_array_add(paths, g_build_filename(g_get_home_dir(), path + 2, NULL));
+    else
+      g_ptr_array_add(paths, g_strdup(path));
+  }
+  g_ptr_array_add(paths, NULL);
+  g_strfreev(parts);
+  events->paths = (gchar **) g_ptr_array_free(paths, FALSE);
+
+  datetime_events_refresh(events);
+
+  return events;
+}
+
+void datetime_events_free(t_datetime_events *events)
+{
+  if (events == NULL)
+    return;
+
+  if (events->cancellable != NULL)
+  {
+    g_cancellable_cancel(events->cancellable);
+    g_object_unref(events->cancellable);
+  }
+
+  g_hash_table_destroy(events->months);
+  g_ptr_array_unref(events->files);
+  g_strfreev(events->paths);
+  g_slice_free(t_datetime_events, events);
+}
+
+/*
+ * Load the files again in the background if they changed;
+ * unchanged files cost a stat() each.
+ */
+void datetime_events_refresh(t_datetime_events *events)
+{
+  t_events_load *load;
+  GTask *task;
+
+  if (events->paths[0] == NULL)
+    return;
+
+  if (events->cancellable != NULL)
+  {
+    events->reload = TRUE;
+    return;
+  }
+
+  load = g_slice_new0(t_events_load);
+  load->paths = g_strdupv(events->paths);
+  load->old = g_ptr_array_ref(events->files);
+
+  events->cancellable = g_cancellable_new();
+  task = g_task_new(NULL, events->cancellable, datetime_events_loaded, events);
+  g_task_set_task_data(task, load, (GDestroyNotify) datetime_events_load_free);
+  g_task_run_in_thread(task, datetime_events_load_thread);
+  g_object_unref(task);
+}
+
+
+
+/*
+ * recurrences
+ */
+
+/*
+ * sorted days of a month a monthly or yearly rule picks
+ */
+static guint datetime_events_month_days(const t_rule *rule,
+                                        guint year, guint month,
+                                        const GDate *start,
+                                        guint32 *days)
+{
+  guint32 first = datetime_events_julian(year, month, 1);
+  guint dim = g_date_get_days_in_month(month, year);
+  GDateWeekday first_wday;
+  guint8 seen[32] = { 0 };
+  gint mday, wday_mday;
+  guint i, n = 0;
+
+  if (rule->n_bymonthday == 0 && rule->n_byday == 0)
+    seen[g_date_get_day(start)] = (g_date_get_day(start) <= dim);
+
+  for (i = 0; i < rule->n_bymonthday; i++)
+  {
+    mday = rule->bymonthday[i];
+    mday = (mday > 0) ? mday : (gint) dim + mday + 1;
+    if (mday >= 1 && mday <= (gint) dim)
+      seen[mday] = 1;
+  }
+
+  /* BYDAY restricts BYMONTHDAY if both are there */
+  first_wday = (first - 1) % 7 + 1;
+  for (i = 0; i < rule->n_byday; i++)
+  {
+    wday_mday = 1 + (rule->byday_wday[i] + 7 - first_wday) % 7;
+    for (mday = wday_mday; mday <= (gint) dim; mday += 7)
+    {
+      if (rule->byday_nth[i] > 0 && mday != wday_mday + 7 * (rule->byday_nth[i] - 1))
+        continue;
+      if (rule->byday_nth[i] < 0 &&
+          mday != wday_mday + 7 * ((gint) (dim - wday_mday) / 7 + rule->byday_nth[i] + 1))
+        continue;
+
+      if (rule->n_bymonthday == 0)
+        seen[mday] = 1;
+      else if (seen[mday] == 1)
+        seen[mday] = 2;
+    }
+  }
+
+  for (mday = 1; mday <= (gint) dim; mday++)
+  {
+    if (seen[mday] == ((rule->n_bymonthday > 0 && rule->n_byday > 0) ? 2 : 1))
+      days[n++] = first + mday - 1;
+  }
+
+  return n;
+}
+
+/*
+ * First day of the k-th period of the rule and the days it picks in it,
+ * in order; start is the event's first day.
+ */
+static guint32 datetime_events_period_days(const t_rule *rule,
+                                           const GDate *start,
+                                           guint64 k,
+                                           guint32 *days,
+                                           guint *n_days)
+{
+  guint32 start_day = g_date_get_julian(start);
+  guint32 period_start, day;
+  GDateWeekday wday;
+  GDate date;
+  guint64 months;
+  guint year, month, i;
+
+  *n_days = 0;
+
+  switch (rule->freq)
+  {
+    case FREQ_DAILY:
+      period_start = start_day + k * rule->interval;
+      datetime_events_dmy(period_start, &date);
+      wday = g_date_get_weekday(&date);
+      for (i = 0; i < rule->n_byday && rule->byday_wday[i] != wday; i++);
+      if ((rule->bymonth == 0 || (rule->bymonth & (1 << g_date_get_month(&date)))) &&
+          (rule->n_byday == 0 || i < rule->n_byday))
+        days[(*n_days)++] = period_start;
+      return period_start;
+
+    case FREQ_WEEKLY:
+      period_start = start_day - (g_date_get_weekday(start) - G_DATE_MONDAY) +
+                     k * 7 * rule->interval;
+      for (i = 0; i < 7; i++)
+      {
+        day = period_start + i;
+        datetime_events_dmy(day, &date);
+        wday = g_date_get_weekday(&date);
+        if (rule->n_byday == 0 && wday != g_date_get_weekday(start))
+          continue;
+        if (rule->n_byday > 0 && memchr(rule->byday_wday, wday, rule->n_byday) == NULL)
+          continue;
+        if (rule->bymonth != 0 && !(rule->bymonth & (1 << g_date_get_month(&date))))
+          continue;
+        days[(*n_days)++] = day;
+      }
+      return period_start;
+
+    case FREQ_MONTHLY:
+      months = (guint64) g_date_get_year(start) * 12 + g_date_get_month(start) - 1 +
+               k * rule->interval;
+      year = months / 12;
+      month = months % 12 + 1;
+      if (year > G_DATE_YEAR_MAX - 1)
+        return G_MAXUINT32;
+      if (rule->bymonth == 0 || (rule->bymonth & (1 << month)))
+        *n_days = datetime_events_month_days(rule, year, month, start, days);
+      return datetime_events_julian(year, month, 1);
+
+    default:
+      year = g_date_get_year(start) + k * rule->interval;
+      if (year > G_DATE_YEAR_MAX - 1)
+        return G_MAXUINT32;
+      for (month = 1; month <= 12; month++)
+      {
+        if (rule->bymonth != 0 ? !(rule->bymonth & (1 << month))
+                               : month != g_date_get_month(start))
+          continue;
+        *n_days += datetime_events_month_days(rule, year, month, start, days + *n_days);
+      }
+      return datetime_events_julian(year, 1, 1);
+  }
+}
+
+/*
+ * the period of the rule holding day, or one before it
+ */
+static guint64 datetime_events_first_period(const t_rule *rule,
+                                            const GDate *start,
+                                            guint32 day)
+{
+  guint32 start_day = g_date_get_julian(start);
+  GDate date;
+
+  if (day <= start_day)
+    return 0;
+
+  datetime_events_dmy(day, &date);
+  switch (rule->freq)
+  {
+    case FREQ_DAILY:
+      return (day - start_day) / rule->interval;
+    case FREQ_WEEKLY:
+      return (day - start_day) / (7 * rule->interval);
+    case FREQ_MONTHLY:
+      return ((g_date_get_year(&date) - g_date_get_year(start)) * 12 +
+              g_date_get_month(&date) - g_date_get_month(start)) / rule->interval;
+    default:
+      return (g_date_get_year(&date) - g_date_get_year(start)) / rule->interval;
+  }
+}
+
+/*
+ * Append the occurrences of a recurring event that touch [first, last].
+ * Rules with a COUNT are walked from the start, the others
+ * from the period before first.
+ */
+static void datetime_events_expand(const t_events_file *file,
+                                   const t_event *event,
+                                   guint32 first, guint32 last,
+                                   GArray *occurrences)
+{
+  const t_rule *rule = &g_array_index(file->rules, t_rule, event->rule - 1);
+  const guint32 *exdates = &g_array_index(file->exdates, guint32, rule->exdates);
+  t_occurrence occurrence;
+  guint32 days[366];
+  guint32 period_start;
+  guint n_days, count = 0, steps, i;
+  guint64 k;
+  GDate start;
+
+  datetime_events_dmy(event->day, &start);
+  occurrence.event = event;
+  occurrence.summary = file->strings->str + event->summary;
+
+  k = (rule->count == 0) ? datetime_events_first_period(rule, &start, first - event->days) : 0;
+  for (steps = 0; steps < DATETIME_EVENTS_MAX_STEPS; steps++, k++)
+  {
+    period_start = datetime_events_period_days(rule, &start, k, days, &n_days);
+    if (period_start > last || (rule->until != 0 && period_start > rule->until))
+      return;
+
+    for (i = 0; i < n_days; i++)
+    {
+      if (days[i] < event->day)
+        continue;
+      if ((rule->until != 0 && days[i] > rule->until) || days[i] > last)
+        return;
+      if (rule->count != 0 && ++count > rule->count)
+        return;
+
+      if (days[i] + event->days <= first ||
+          bsearch(&days[i], exdates, rule->n_exdates, sizeof(guint32),
+                  datetime_events_compare_days) != NULL)
+        continue;
+
+      occurrence.day = days[i];
+      g_array_append_val(occurrences, occurrence);
+    }
+  }
+}
+
+/*
+ * the recurring events of a month, expanded when first asked for
+ */
+static GArray * datetime_events_get_occurrences(t_datetime_events *events,
+                                                guint year, guint month,
+                                                guint32 first, guint32 last)
+{
+  gpointer key = GUINT_TO_POINTER(year * 12 + month);
+  const t_events_file *file;
+  GArray *occurrences;
+  guint i, j;
+
+  occurrences = g_hash_table_lookup(events->months, key);
+  if (occurrences != NULL)
+    return occurrences;
+
+  /* events in UTC may fall on the day before or after locally */
+  occurrences = g_array_new(FALSE, FALSE, sizeof(t_occurrence));
+  for (i = 0; i < events->files->len; i++)
+  {
+    file = g_ptr_array_index(events->files, i);
+    for (j = 0; j < file->recurring->len; j++)
+      datetime_events_expand(file, &g_array_index(file->recurring, t_event, j),
+                             first - 1, last + 1, occurrences);
+  }
+
+  g_hash_table_insert(events->months, key, occurrences);
+  return occurrences;
+}
+
+/*
+ * call func for the days of [first, last] an event starting on day covers,
+ * with its local start time on the first day and -1 on the others
+ */
+static void datetime_events_visit(const t_event *event, guint32 day,
+                                  const gchar *summary,
+                                  guint32 first, guint32 last,
+                                  t_events_day_func func, gpointer user_data)
+{
+  gint32 time = event->time;
+  struct tm tm;
+  guint32 d;
+
+  if (event->flags & EVENT_UTC)
+  {
+    datetime_localtime((gint64) (day - DATETIME_EVENTS_EPOCH_DAY) * 86400 + event->time, &tm);
+    day = datetime_events_julian(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
+    time = tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec;
+  }
+
+  for (d = MAX(day, first); d < day + event->days && d <= last; d++)
+    func(d - first + 1, (d == day) ? time : -1, summary, user_data);
+}
+
+/*
+ * call func for every day of a month with an event, once per event;
+ * costs a binary search plus the events of the month
+ */
+static void datetime_events_foreach(t_datetime_events *events,
+                                    guint year, guint month,
+                                    t_events_day_func func, gpointer user_data)
+{
+  const t_events_file *file;
+  const t_event *event;
+  const t_occurrence *occurrence;
+  GArray *occurrences;
+  guint32 first, last, from;
+  guint lo, hi, mid, i;
+
+  first = datetime_events_julian(year, month, 1);
+  if (first == 0)
+    return;
+  last = first + g_date_get_days_in_month(month, year) - 1;
+
+  for (i = 0; i < events->files->len; i++)
+  {
+    file = g_ptr_array_index(events->files, i);
+
+    /* the first event that may still last into the month */
+    from = first - MIN(first, file->max_days + 1);
+    lo = 0;
+    hi = file->events->len;
+    while (lo < hi)
+    {
+      mid = lo + (hi - lo) / 2;
+      if (g_array_index(file->events, t_event, mid).day < from)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+    for (; lo < file->events->len; lo++)
+    {
+      event = &g_array_index(file->events, t_event, lo);
+      if (event->day > last + 1)
+        break;
+      datetime_events_visit(event, event->day, file->strings->str + event->summary,
+                            first, last, func, user_data);
+    }
+  }
+
+  occurrences = datetime_events_get_occurrences(events, year, month, first, last);
+  for (i = 0; i < occurrences->len; i++)
+  {
+    occurrence = &g_array_index(occurrences, t_occurrence, i);
+    datetime_events_visit(occurrence->event, occurrence->day, occurrence->summary,
+                          first, last, func, user_data);
+  }
+}
+
+static void datetime_events_mark_day(guint mday, gint32 time,
+                                     const gchar *summary, gpointer user_data)
+{
+  guint32 *days = user_data;
+
+  *days |= 1 << mday;
+}
+
+/*
+ * days of a month (1-12) with events, as a mask with bit mday set
+ */
+guint32 datetime_events_get_month(t_datetime_events *events,
+                                  guint year, guint month)
+{
+  guint32 days = 0;
+
+  datetime_events_foreach(events, year, month, datetime_events_mark_day, &days);
+
+  return days;
+}
+
+typedef struct {
+  guint mday;
+  GArray *entries;
+} t_day_entries;
+
+typedef struct {
+  gint32 time;
+  const gchar *summary;
+} t_day_entry;
+
+static void datetime_events_add_entry(guint mday, gint32 time,
+                                      const gchar *summary, gpointer user_data)
+{
+  t_day_entries *day = user_data;
+  t_day_entry entry = { time, summary };
+
+  if (mday == day->mday)
+    g_array_append_val(day->entries, entry);
+}
+
+static gint datetime_events_compare_entries(gconstpointer a, gconstpointer b)
+{
+  const t_day_entry *entry_a = a;
+  const t_day_entry *entry_b = b;
+
+  if (entry_a->time != entry_b->time)
+    return (entry_a->time > entry_b->time) ? 1 : -1;
+
+  return g_utf8_collate(entry_a->summary, entry_b->summary);
+}
+
+/*
+ * Pango markup listing the events of a day, all-day ones first,
+ * or NULL if there are none
+ */
+gchar * datetime_events_get_day(t_datetime_events *events,
+                                guint year, guint month, guint mday)
+{
+  t_day_entries day;
+  const t_day_entry *entry;
+  GString *markup;
+  gchar *summary;
+  guint i;
+
+  day.mday = mday;
+  day.entries = g_array_new(FALSE, FALSE, sizeof(t_day_entry));
+  datetime_events_foreach(events, year, month, datetime_events_add_entry, &day);
+
+  if (day.entries->len == 0)
+  {
+    g_array_unref(day.entries);
+    return NULL;
+  }
+
+  g_array_sort(day.entries, datetime_events_compare_entries);
+
+  markup = g_string_new(NULL);
+  for (i = 0; i < day.entries->len; i++)
+  {
+    entry = &g_array_index(day.entries, t_day_entry, i);
+    if (i > 0)
+      g_string_append_c(markup, '\n');
+    if (entry->time >= 0)
+      g_string_append_printf(markup, "<b>%02d:%02d</b> ",
+                             entry->time / 3600, entry->time / 60 % 60);
+
+    summary = g_markup_escape_text(entry->summary, -1);
+    g_string_append(markup, summary);
+    g_free(summary);
+  }
+
+  g_array_unref(day.entries);
+  return g_string_free(markup, FALSE);
+}
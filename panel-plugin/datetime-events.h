@@ -0,0 +1,60 @@
+/*  $Id$
+ *
+ *  Copyright (C) 2003 Choe Hwanjin(krisna@kldp.org)
+ *  Copyright (c) 2006 Remco den Breeje <remco@sx.mine.nu>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef DATETIME_EVENTS_H
+#define DATETIME_EVENTS_H
+
+#include <glib.h>
+
+/*
+ * Events of local iCalendar (.ics) files, for the calendar popup.
+ * The files are parsed by a worker thread into a day-indexed cache that is
+ * kept on disk next to the user's other caches and reused as long as the
+ * file's modification time and size match. Recurring events are expanded
+ * when a month is first asked for.
+ */
+typedef struct _t_datetime_events t_datetime_events;
+
+/* called in the main thread whenever newly loaded events are available */
+typedef void (*t_datetime_events_func)(gpointer user_data);
+
+t_datetime_events *
+datetime_events_new(const gchar *files,
+    t_datetime_events_func func,
+    gpointer user_data);
+
+void
+datetime_events_free(t_datetime_events *events);
+
+void
+datetime_events_refresh(t_datetime_events *events);
+
+guint32
+datetime_events_get_month(t_datetime_events *events,
+    guint year,
+    guint month);
+
+gchar *
+datetime_events_get_day(t_datetime_events *events,
+    guint year,
+    guint month,
+    guint mday);
+
+#endif /* datetime-events.h */
@@ -0,0 +1,910 @@
+/*  $Id$
+ *
+ *  Copyright (C) 2003 Choe Hwanjin(krisna@kldp.org)
+ *  Copyright (c) 2006 Remco den Breeje <remco@sx.mine.nu>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+/* local includes */
+#include <time.h>
+#include <string.h>
+#include <locale.h>
+
+/* xfce includes */
+#include <libxfce4util/libxfce4util.h>
+
+#include "datetime-format.h"
+
+typedef enum
+{
+  /* copy a run of literal text */
+  OP_LITERAL,
+
+  /* print a numeric tm field, padded to a fixed width */
+  OP_NUMBER,
+
+  /* copy a day, month or AM/PM name from the locale cache */
+  OP_NAME,
+
+  /* print the leading digits of the fraction of the second */
+  OP_FRACTION,
+
+  /* anything else (names, locale dependent or modified conversions) */
+  OP_STRFTIME
+} t_op_type;
+
+typedef enum
+{
+  FIELD_SEC,
+  FIELD_MIN,
+  FIELD_HOUR,
+  FIELD_HOUR12,
+  FIELD_MDAY,
+  FIELD_MON,
+  FIELD_YEAR,
+  FIELD_YEAR2,
+  FIELD_YDAY,
+  FIELD_WDAY,
+  FIELD_WDAY_ISO
+} t_field;
+
+typedef enum
+{
+  NAMES_ABDAY,      /* %a */
+  NAMES_DAY,        /* %A */
+  NAMES_ABMON,      /* %b, %h */
+  NAMES_MON,        /* %B */
+  NAMES_AMPM,       /* %p */
+  NAMES_AMPM_LOWER  /* %P */
+} t_names;
+
+typedef struct {
+  t_op_type type;
+  t_field field;
+  t_names names;  /* of OP_NAME */
+  guint8 width;   /* minimum number of digits, digits of OP_FRACTION */
+  gchar pad;      /* '0' or ' ' */
+  guint offset;   /* literal text or conversion spec in program->strings */
+  guint length;
+} t_op;
+
+struct _t_datetime_format {
+  t_op *ops;
+  guint n_ops;
+  gchar *strings;
+  guint units;    /* t_datetime_unit mask */
+};
+
+/*
+ * Numeric conversions which glibc prints without looking at the locale.
+ * Composite conversions are expanded into these when compiling.
+ */
+static const struct {
+  gchar conversion;
+  t_field field;
+  guint8 width;
+  gchar pad;
+} numeric_conversions[] = {
+  { 'S', FIELD_SEC,      2, '0' },
+  { 'M', FIELD_MIN,      2, '0' },
+  { 'H', FIELD_HOUR,     2, '0' },
+  { 'k', FIELD_HOUR,     2, ' ' },
+  { 'I', FIELD_HOUR12,   2, '0' },
+  { 'l', FIELD_HOUR12,   2, ' ' },
+  { 'd', FIELD_MDAY,     2, '0' },
+  { 'e', FIELD_MDAY,     2, ' ' },
+  { 'm', FIELD_MON,      2, '0' },
+  { 'Y', FIELD_YEAR,     4, '0' },
+  { 'y', FIELD_YEAR2,    2, '0' },
+  { 'j', FIELD_YDAY,     3, '0' },
+  { 'w', FIELD_WDAY,     1, '0' },
+  { 'u', FIELD_WDAY_ISO, 1, '0' }
+};
+
+/*
+ * Units each conversion depends on. Conversions that are not listed
+ * (%c, %x, %X, %r, unknown ones) depend on the locale and are probed.
+ */
+static const struct {
+  gchar conversion;
+  guint units;
+} conversion_units[] = {
+  { 'S', DATETIME_UNIT_SECOND },
+  { 's', DATETIME_UNIT_SECOND },
+  { 'T', DATETIME_UNIT_SECOND },
+  { 'M', DATETIME_UNIT_MINUTE },
+  { 'R', DATETIME_UNIT_MINUTE },
+  { 'H', DATETIME_UNIT_HOUR },
+  { 'k', DATETIME_UNIT_HOUR },
+  { 'I', DATETIME_UNIT_HOUR },
+  { 'l', DATETIME_UNIT_HOUR },
+  { 'p', DATETIME_UNIT_HOUR },
+  { 'P', DATETIME_UNIT_HOUR },
+  { 'z', DATETIME_UNIT_HOUR },  /* daylight saving time starts or ends on the hour */
+  { 'Z', DATETIME_UNIT_HOUR },
+  { 'a', DATETIME_UNIT_DAY },
+  { 'A', DATETIME_UNIT_DAY },
+  { 'u', DATETIME_UNIT_DAY },
+  { 'w', DATETIME_UNIT_DAY },
+  { 'd', DATETIME_UNIT_DAY },
+  { 'e', DATETIME_UNIT_DAY },
+  { 'j', DATETIME_UNIT_DAY },
+  { 'D', DATETIME_UNIT_DAY },
+  { 'F', DATETIME_UNIT_DAY },
+  { 'x', DATETIME_UNIT_DAY },
+  { 'V', DATETIME_UNIT_WEEK },
+  { 'G', DATETIME_UNIT_WEEK },
+  { 'g', DATETIME_UNIT_WEEK },
+  { 'W', DATETIME_UNIT_WEEK | DATETIME_UNIT_YEAR },
+  { 'U', DATETIME_UNIT_WEEK_SUN | DATETIME_UNIT_YEAR },
+  { 'b', DATETIME_UNIT_MONTH },
+  { 'B', DATETIME_UNIT_MONTH },
+  { 'h', DATETIME_UNIT_MONTH },
+  { 'm', DATETIME_UNIT_MONTH },
+  { 'y', DATETIME_UNIT_YEAR },
+  { 'Y', DATETIME_UNIT_YEAR },
+  { 'C', DATETIME_UNIT_YEAR },
+  { 'n', 0 },
+  { 't', 0 },
+  { '%', 0 }
+};
+
+/*
+ * Names strftime() looks up in the locale, with the number of names
+ * and the index of the first one in the locale cache.
+ */
+static const struct {
+  gchar conversion;
+  t_names names;
+  guint count;
+  guint first;
+} name_conversions[] = {
+  { 'a', NAMES_ABDAY,       7,  0 },
+  { 'A', NAMES_DAY,         7,  7 },
+  { 'b', NAMES_ABMON,      12, 14 },
+  { 'h', NAMES_ABMON,      12, 14 },
+  { 'B', NAMES_MON,        12, 26 },
+  { 'p', NAMES_AMPM,        2, 38 },
+  { 'P', NAMES_AMPM_LOWER,  2, 40 }
+};
+
+#define DATETIME_LOCALE_NAMES 42
+
+/*
+ * The names of the current locale, rendered by strftime() once instead of
+ * on every update, and whether its text needs converting to UTF-8.
+ */
+typedef struct {
+  gchar *lc_time;   /* locale the cache was built for */
+  gchar *lc_ctype;
+  gboolean utf8;
+  gchar *names[DATETIME_LOCALE_NAMES];
+  guint8 lengths[DATETIME_LOCALE_NAMES];
+} t_locale_cache;
+
+static t_locale_cache locale_cache = { NULL };
+
+/*
+ * the locale cache, rebuilt if the locale changed since it was last used
+ */
+static const t_locale_cache * datetime_locale_cache_get(void)
+{
+  const gchar *lc_time = setlocale(LC_TIME, NULL);
+  const gchar *lc_ctype = setlocale(LC_CTYPE, NULL);
+  struct tm tm = { 0 };
+  gchar spec[3] = { '%', '\0', '\0' };
+  gchar buf[DATETIME_MAX_STRLEN];
+  gsize len;
+  guint i, j, k;
+
+  if (locale_cache.lc_time != NULL &&
+      g_strcmp0(locale_cache.lc_time, lc_time) == 0 &&
+      g_strcmp0(locale_cache.lc_ctype, lc_ctype) == 0)
+    return &locale_cache;
+
+  g_free(locale_cache.lc_time);
+  g_free(locale_cache.lc_ctype);
+  locale_cache.lc_time = g_strdup(lc_time);
+  locale_cache.lc_ctype = g_strdup(lc_ctype);
+  locale_cache.utf8 = g_get_charset(NULL);
+
+  /* the names are kept in the locale's encoding, like strftime() prints them */
+  for (i = 0; i < G_N_ELEMENTS(name_conversions); i++)
+  {
+    spec[1] = name_conversions[i].conversion;
+    for (j = 0; j < name_conversions[i].count; j++)
+    {
+      tm.tm_wday = j;
+      tm.tm_mon = j;
+      tm.tm_hour = 12 * j;
+
+      len = MIN(strftime(buf, sizeof(buf), spec, &tm), G_MAXUINT8);
+      buf[len] = '\0';
+
+      k = name_conversions[i].first + j;
+      g_free(locale_cache.names[k]);
+      locale_cache.names[k] = g_strdup(buf);
+      locale_cache.lengths[k] = len;
+    }
+  }
+
+  DBG("locale %s, %s", lc_time, locale_cache.utf8 ? "UTF-8" : "converted to UTF-8");
+
+  return &locale_cache;
+}
+
+/*
+ * Convert len bytes of text in the locale's encoding to UTF-8;
+ * text of UTF-8 locales is only validated.
+ */
+static gchar * datetime_locale_to_utf8(const t_locale_cache *cache,
+                                       const gchar *text, gsize len)
+{
+  if (!cache->utf8)
+    return g_locale_to_utf8(text, len, NULL, NULL, NULL);
+
+  if (!g_utf8_validate(text, len, NULL))
+    return NULL;
+
+  return g_strndup(text, len);
+}
+
+static const struct {
+  gchar conversion;
+  const gchar *expansion;
+} composite_conversions[] = {
+  { 'D', "%m/%d/%y" },
+  { 'F', "%Y-%m-%d" },
+  { 'R', "%H:%M" },
+  { 'T', "%H:%M:%S" }
+};
+
+static void datetime_format_add_literal(GArray *ops, GString *strings,
+                                        const gchar *text, gsize length)
+{
+  t_op op = { 0 };
+  t_op *last;
+
+  if (length == 0)
+    return;
+
+  /* extend the previous run if possible, literals are stored back to back */
+  if (ops->len > 0)
+  {
+    last = &g_array_index(ops, t_op, ops->len - 1);
+    if (last->type == OP_LITERAL && last->offset + last->length == strings->len)
+    {
+      g_string_append_len(strings, text, length);
+      last->length += length;
+      return;
+    }
+  }
+
+  op.type = OP_LITERAL;
+  op.offset = strings->len;
+  op.length = length;
+  g_string_append_len(strings, text, length);
+  g_array_append_val(ops, op);
+}
+
+static void datetime_format_add_spec(GArray *ops, GString *strings,
+                                     t_op_type type, const gchar *spec,
+                                     gsize length)
+{
+  t_op op = { 0 };
+
+  op.type = type;
+  op.offset = strings->len;
+  op.length = length;
+
+  /* keep the spec nul terminated, it may be passed to strftime() */
+  g_string_append_len(strings, spec, length);
+  g_string_append_c(strings, '\0');
+  g_array_append_val(ops, op);
+}
+
+static gboolean datetime_format_add_conversion(GArray *ops, GString *strings,
+                                               gchar conversion)
+{
+  gchar spec[3] = { '%', conversion, '\0' };
+  t_op *op;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS(numeric_conversions); i++)
+  {
+    if (numeric_conversions[i].conversion != conversion)
+      continue;
+
+    datetime_format_add_spec(ops, strings, OP_NUMBER, spec, 2);
+    op = &g_array_index(ops, t_op, ops->len - 1);
+    op->field = numeric_conversions[i].field;
+    op->width = numeric_conversions[i].width;
+    op->pad = numeric_conversions[i].pad;
+    return TRUE;
+  }
+
+  for (i = 0; i < G_N_ELEMENTS(name_conversions); i++)
+  {
+    if (name_conversions[i].conversion != conversion)
+      continue;
+
+    datetime_format_add_spec(ops, strings, OP_NAME, spec, 2);
+    op = &g_array_index(ops, t_op, ops->len - 1);
+    op->names = name_conversions[i].names;
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+/*
+ * Find the units a locale dependent conversion depends on by rendering it
+ * for times that differ in a single field.
+ */
+static guint datetime_format_probe_units(const gchar *spec)
+{
+  static const struct tm base = {
+    .tm_sec   = 1,
+    .tm_min   = 1,
+    .tm_hour  = 1,
+    .tm_mday  = 1,
+    .tm_mon   = 0,
+    .tm_year  = 70, /* use 1970 so strftime() can convert '%s' */
+    .tm_wday  = 4,
+    .tm_yday  = 0,
+    .tm_isdst = 0
+  };
+  struct tm other;
+  gchar buf1[DATETIME_MAX_STRLEN];
+  gchar buf2[DATETIME_MAX_STRLEN];
+  gsize len1, len2;
+  guint units = 0;
+  guint i;
+
+  len1 = strftime(buf1, sizeof(buf1), spec, &base);
+  buf1[len1] = '\0';
+
+  for (i = 0; i < 5; i++)
+  {
+    other = base;
+    switch (i)
+    {
+      case 0: other.tm_sec = 2;   break;
+      case 1: other.tm_min = 2;   break;
+      case 2: other.tm_hour = 13; break;
+      case 3: other.tm_hour = 2;  break;
+      case 4: other.tm_mday = 2; other.tm_wday = 5; other.tm_yday = 1; break;
+    }
+
+    len2 = strftime(buf2, sizeof(buf2), spec, &other);
+    buf2[len2] = '\0';
+    if (len1 == len2 && strcmp(buf1, buf2) == 0)
+      continue;
+
+    switch (i)
+    {
+      case 0:  units |= DATETIME_UNIT_SECOND; break;
+      case 1:  units |= DATETIME_UNIT_MINUTE; break;
+      case 4:  units |= DATETIME_UNIT_DAY;    break;
+      default: units |= DATETIME_UNIT_HOUR;   break;
+    }
+  }
+
+  /* month and year names can only change at midnight as well */
+  return units;
+}
+
+/*
+ * Units the conversion spec '%' [flags] [width] [E|O] conversion depends on
+ */
+static guint datetime_format_spec_units(const gchar *spec, gsize length)
+{
+  gchar conversion = spec[length - 1];
+  gchar *probe;
+  guint units;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS(conversion_units); i++)
+  {
+    if (conversion_units[i].conversion == conversion)
+      return conversion_units[i].units;
+  }
+
+  probe = g_strndup(spec, length);
+  units = datetime_format_probe_units(probe);
+  g_free(probe);
+
+  return units;
+}
+
+/*
+ * Parse a strftime() format the same way glibc does:
+ * '%' [flags] [width] [E|O] conversion
+ */
+t_datetime_format * datetime_format_compile(const gchar *format)
+{
+  t_datetime_format *program;
+  GArray *ops;
+  GString *strings;
+  const gchar *p, *spec, *run;
+  gboolean plain;
+  guint width;
+  guint units;
+  guint i;
+
+  if (format == NULL)
+    return NULL;
+
+  ops = g_array_new(FALSE, FALSE, sizeof(t_op));
+  strings = g_string_new(NULL);
+  units = 0;
+
+  run = format;
+  for (p = format; *p != '\0'; p++)
+  {
+    if (*p != '%')
+      continue;
+
+    datetime_format_add_literal(ops, strings, run, p - run);
+    spec = p++;
+
+    /* flags, field width and modifiers force the generic path */
+    plain = TRUE;
+    while (*p == '_' || *p == '-' || *p == '0' || *p == '^' || *p == '#' || *p == '+')
+    {
+      plain = FALSE;
+      p++;
+    }
+    width = 0;
+    while (g_ascii_isdigit(*p))
+    {
+      plain = FALSE;
+      width = MIN(width * 10 + (*p - '0'), 100);
+      p++;
+    }
+    if (*p == 'E' || *p == 'O')
+    {
+      plain = FALSE;
+      p++;
+    }
+
+    if (*p == '\0')
+    {
+      /* dangling '%', let strftime() decide what to print */
+      datetime_format_add_spec(ops, strings, OP_STRFTIME, spec, p - spec);
+      run = p;
+      break;
+    }
+
+    run = p + 1;
+
+    /*
+     * GNU date's %N, nanoseconds, or the first 1-9 digits of them with
+     * %1N ... %9N; strftime() doesn't know it. Time is only known to the
+     * millisecond, further digits are 0.
+     */
+    if (*p == 'N')
+    {
+      datetime_format_add_spec(ops, strings, OP_FRACTION, spec, p + 1 - spec);
+      g_array_index(ops, t_op, ops->len - 1).width = (width == 0) ? 9 : MIN(width, 9);
+      units |= DATETIME_UNIT_SUBSECOND;
+      continue;
+    }
+
+    units |= datetime_format_spec_units(spec, p + 1 - spec);
+
+    if (plain)
+    {
+      switch (*p)
+      {
+        case '%':
+          datetime_format_add_literal(ops, strings, "%", 1);
+          continue;
+        case 'n':
+          datetime_format_add_literal(ops, strings, "\n", 1);
+          continue;
+        case 't':
+          datetime_format_add_literal(ops, strings, "\t", 1);
+          continue;
+        default:
+          break;
+      }
+
+      if (datetime_format_add_conversion(ops, strings, *p))
+        continue;
+
+      for (i = 0; i < G_N_ELEMENTS(composite_conversions); i++)
+      {
+        const gchar *c;
+
+        if (composite_conversions[i].conversion != *p)
+          continue;
+
+        for (c = composite_conversions[i].expansion; *c != '\0'; c++)
+        {
+          if (*c == '%')
+            datetime_format_add_conversion(ops, strings, *++c);
+          else
+            datetime_format_add_literal(ops, strings, c, 1);
+        }
+        break;
+      }
+      if (i < G_N_ELEMENTS(composite_conversions))
+        continue;
+    }
+
+    datetime_format_add_spec(ops, strings, OP_STRFTIME, spec, p + 1 - spec);
+  }
+  datetime_format_add_literal(ops, strings, run, p - run);
+
+  program = g_slice_new0(t_datetime_format);
+  program->n_ops = ops->len;
+  program->ops = (t_op *) g_array_free(ops, FALSE);
+  program->strings = g_string_free(strings, FALSE);
+  program->units = units;
+
+  return program;
+}
+
+void datetime_format_free(t_datetime_format *program)
+{
+  if (program == NULL)
+    return;
+
+  g_free(program->ops);
+  g_free(program->strings);
+  g_slice_free(t_datetime_format, program);
+}
+
+/*
+ * Value of a numeric field, or -1 if it is outside of the range in which
+ * the result is known to match strftime() exactly.
+ */
+static gint datetime_format_field_value(t_field field, const struct tm *tm)
+{
+  gint value;
+
+  switch (field)
+  {
+    case FIELD_SEC:      value = tm->tm_sec;  break;
+    case FIELD_MIN:      value = tm->tm_min;  break;
+    case FIELD_HOUR:     value = tm->tm_hour; break;
+    case FIELD_MDAY:     value = tm->tm_mday; break;
+    case FIELD_MON:      value = tm->tm_mon + 1; break;
+    case FIELD_YDAY:     value = tm->tm_yday + 1; break;
+    case FIELD_WDAY:     value = tm->tm_wday; break;
+
+    case FIELD_HOUR12:
+      if (tm->tm_hour < 0 || tm->tm_hour > 23)
+        return -1;
+      value = tm->tm_hour % 12 == 0 ? 12 : tm->tm_hour % 12;
+      break;
+
+    case FIELD_WDAY_ISO:
+      if (tm->tm_wday < 0 || tm->tm_wday > 6)
+        return -1;
+      value = tm->tm_wday == 0 ? 7 : tm->tm_wday;
+      break;
+
+    case FIELD_YEAR:
+      /* libc implementations disagree on padding outside of 1000-9999 */
+      value = tm->tm_year + 1900;
+      if (value < 1000)
+        return -1;
+      break;
+
+    case FIELD_YEAR2:
+      if (tm->tm_year < 0)
+        return -1;
+      value = tm->tm_year % 100;
+      break;
+
+    default:
+      return -1;
+  }
+
+  return value;
+}
+
+/*
+ * Index of a name in the locale cache, or -1 if the field is out of range
+ */
+static gint datetime_format_name_index(t_names names, const struct tm *tm)
+{
+  gint value;
+  guint i;
+
+  switch (names)
+  {
+    case NAMES_ABDAY:
+    case NAMES_DAY:
+      value = tm->tm_wday;
+      break;
+    case NAMES_ABMON:
+    case NAMES_MON:
+      value = tm->tm_mon;
+      break;
+    default:
+      if (tm->tm_hour < 0 || tm->tm_hour > 23)
+        return -1;
+      value = tm->tm_hour / 12;
+      break;
+  }
+
+  for (i = 0; i < G_N_ELEMENTS(name_conversions); i++)
+  {
+    if (name_conversions[i].names != names)
+      continue;
+
+    if (value < 0 || value >= (gint) name_conversions[i].count)
+      return -1;
+
+    return name_conversions[i].first + value;
+  }
+
+  return -1;
+}
+
+/*
+ * Render the program into buf, in the locale's encoding.
+ * Like strftime(), returns the length of the result or 0 if it is empty
+ * or does not fit into buf including the terminating nul.
+ */
+gsize datetime_format_render(const t_datetime_format *program,
+                             const struct tm *tm,
+                             gint msec,
+                             gchar *buf,
+                             gsize buf_size)
+{
+  const t_locale_cache *cache;
+  const t_op *op;
+  gsize len = 0;
+  gsize n;
+  gchar digits[9];
+  gchar scratch[DATETIME_MAX_STRLEN];
+  gint value;
+  gint i;
+
+  if (program == NULL || buf_size == 0)
+    return 0;
+
+  cache = datetime_locale_cache_get();
+
+  for (op = program->ops; op < program->ops + program->n_ops; op++)
+  {
+    switch (op->type)
+    {
+      case OP_LITERAL:
+        if (len + op->length >= buf_size)
+          return 0;
+        memcpy(buf + len, program->strings + op->offset, op->length);
+        len += op->length;
+        continue;
+
+      case OP_NUMBER:
+        value = datetime_format_field_value(op->field, tm);
+        if (value < 0 || value > 9999 || (value > 999 && op->width < 4)
+            || (value > 99 && op->width < 3) || (value > 9 && op->width < 2))
+          break; /* out of range, use strftime() */
+
+        for (i = op->width - 1; i >= 0; i--)
+        {
+          digits[i] = (i == op->width - 1 || value != 0) ? '0' + value % 10 : op->pad;
+          value /= 10;
+        }
+        if (len + op->width >= buf_size)
+          return 0;
+        memcpy(buf + len, digits, op->width);
+        len += op->width;
+        continue;
+
+      case OP_FRACTION:
+        value = CLAMP(msec, 0, 999);
+        for (i = 0; i < op->width; i++)
+        {
+          digits[i] = (i < 3) ? '0' + value / 100 : '0';
+          value = value % 100 * 10;
+        }
+        if (len + op->width >= buf_size)
+          return 0;
+        memcpy(buf + len, digits, op->width);
+        len += op->width;
+        continue;
+
+      case OP_NAME:
+        i = datetime_format_name_index(op->names, tm);
+        if (i < 0)
+          break; /* out of range, use strftime() */
+
+        if (len + cache->lengths[i] >= buf_size)
+          return 0;
+        memcpy(buf + len, cache->names[i], cache->lengths[i]);
+        len += cache->lengths[i];
+        continue;
+
+      default:
+        break;
+    }
+
+    /* a single conversion always fits, 0 means its result is empty */
+    n = strftime(scratch, sizeof(scratch), program->strings + op->offset, tm);
+    if (len + n >= buf_size)
+      return 0;
+    memcpy(buf + len, scratch, n);
+    len += n;
+  }
+
+  if (len == 0)
+    return 0;
+
+  buf[len] = '\0';
+  return len;
+}
+
+/*
+ * Get date/time string
+ */
+gchar * datetime_do_utf8strftime(const char *format, const struct tm *tm)
+{
+  int len;
+  gchar buf[DATETIME_MAX_STRLEN];
+  gchar *utf8str = NULL;
+
+  /* get formatted date/time */
+  len = strftime(buf, sizeof(buf)-1, format, tm);
+  if (len == 0)
+    return g_strdup(_("Invalid format"));
+
+  buf[len] = '\0';  /* make sure nul terminated string */
+  utf8str = datetime_locale_to_utf8(datetime_locale_cache_get(), buf, len);
+  if(utf8str == NULL)
+    return g_strdup(_("Error"));
+
+  return utf8str;
+}
+
+/*
+ * Get date/time string of a compiled format
+ */
+gchar * datetime_format_render_utf8(const t_datetime_format *program,
+                                    const struct tm *tm,
+                                    gint msec)
+{
+  gsize len;
+  gchar buf[DATETIME_MAX_STRLEN];
+  gchar *utf8str = NULL;
+
+  /* get formatted date/time, with the same limit datetime_do_utf8strftime() uses */
+  len = datetime_format_render(program, tm, msec, buf, sizeof(buf)-1);
+  if (len == 0)
+    return g_strdup(_("Invalid format"));
+
+  /* rendering brought the locale cache up to date */
+  utf8str = datetime_locale_to_utf8(&locale_cache, buf, len);
+  if(utf8str == NULL)
+    return g_strdup(_("Error"));
+
+  return utf8str;
+}
+
+guint datetime_format_get_units(const t_datetime_format *program)
+{
+  if (program == NULL)
+    return 0;
+
+  return program->units;
+}
+
+/*
+ * Local midnight at the start of the given day;
+ * mktime() takes care of normalizing overflowing fields
+ * and of days that don't start at 00:00 because of daylight saving time.
+ */
+static gint64 datetime_local_midnight_ms(struct tm tm, gint year, gint mon, gint mday)
+{
+  time_t midnight;
+
+  tm.tm_year = year;
+  tm.tm_mon = mon;
+  tm.tm_mday = mday;
+  tm.tm_hour = 0;
+  tm.tm_min = 0;
+  tm.tm_sec = 0;
+  tm.tm_isdst = -1;
+
+  midnight = mktime(&tm);
+  if (midnight == (time_t) -1)
+    return G_MAXINT64;
+
+  return (gint64) midnight * 1000;
+}
+
+/*
+ * Compute the wall-clock time (in milliseconds) at which the output of a
+ * format depending on the given units will change next after time_ms,
+ * or G_MAXINT64 if it never changes.
+ * tm is the local time of time_ms, which callers already have at hand.
+ */
+gint64 datetime_next_change(guint units, gint64 time_ms, const struct tm *tm)
+{
+  time_t timeval_s = time_ms / 1000;
+  gint64 next_ms = G_MAXINT64;
+  gint64 midnight_ms;
+  gint sec;
+
+  if (units == 0)
+    return G_MAXINT64;
+
+  if (units & DATETIME_UNIT_SUBSECOND)
+    return (time_ms / DATETIME_SUBSECOND_MS + 1) * DATETIME_SUBSECOND_MS;
+
+  if (units & DATETIME_UNIT_SECOND)
+    return ((gint64) timeval_s + 1) * 1000;
+
+  /*
+   * Elapsed time to the next full minute or hour on the local clock.
+   * When the clock is turned back, this wakes once more than needed,
+   * when it is turned forward it lands on the first valid time.
+   * A leap second (tm_sec 60 in "right/" zones) ends with its minute,
+   * one second later.
+   */
+  sec = MIN(tm->tm_sec, 59);
+
+  if (units & DATETIME_UNIT_MINUTE)
+    return ((gint64) timeval_s + 60 - sec) * 1000;
+
+  if (units & DATETIME_UNIT_HOUR)
+    return ((gint64) timeval_s + 3600 - tm->tm_min * 60 - sec) * 1000;
+
+  if (units & DATETIME_UNIT_DAY)
+    next_ms = datetime_local_midnight_ms(*tm, tm->tm_year, tm->tm_mon, tm->tm_mday + 1);
+
+  if (units & DATETIME_UNIT_WEEK)
+  {
+    midnight_ms = datetime_local_midnight_ms(*tm, tm->tm_year, tm->tm_mon,
+                                             tm->tm_mday + 7 - (tm->tm_wday + 6) % 7);
+    next_ms = MIN(next_ms, midnight_ms);
+  }
+
+  if (units & DATETIME_UNIT_WEEK_SUN)
+  {
+    midnight_ms = datetime_local_midnight_ms(*tm, tm->tm_year, tm->tm_mon,
+                                             tm->tm_mday + 7 - tm->tm_wday);
+    next_ms = MIN(next_ms, midnight_ms);
+  }
+
+  if (units & DATETIME_UNIT_MONTH)
+  {
+    midnight_ms = datetime_local_midnight_ms(*tm, tm->tm_year, tm->tm_mon + 1, 1);
+    next_ms = MIN(next_ms, midnight_ms);
+  }
+
+  if (units & DATETIME_UNIT_YEAR)
+  {
+    midnight_ms = datetime_local_midnight_ms(*tm, tm->tm_year + 1, 0, 1);
+    next_ms = MIN(next_ms, midnight_ms);
+  }
+
+  /* never go backwards, e.g. if mktime() failed */
+  if (next_ms <= time_ms)
+    next_ms = ((gint64) timeval_s + 1) * 1000;
+
+  return next_ms;
+}
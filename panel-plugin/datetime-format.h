@@ -0,0 +1,88 @@
+/*  $Id$
+ *
+ *  Copyright (C) 2003 Choe Hwanjin(krisna@kldp.org)
+ *  Copyright (c) 2006 Remco den Breeje <remco@sx.mine.nu>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef DATETIME_FORMAT_H
+#define DATETIME_FORMAT_H
+
+#include <time.h>
+#include <glib.h>
+
+#define DATETIME_MAX_STRLEN 256
+
+/*
+ * A strftime() format string compiled into a list of literal runs and
+ * typed field operations, so it does not have to be parsed on every update.
+ */
+typedef struct _t_datetime_format t_datetime_format;
+
+/*
+ * Calendar units whose change can alter the output of a format.
+ */
+typedef enum
+{
+  DATETIME_UNIT_SECOND   = 1 << 0,
+  DATETIME_UNIT_MINUTE   = 1 << 1,
+  DATETIME_UNIT_HOUR     = 1 << 2,
+  DATETIME_UNIT_DAY      = 1 << 3,
+  DATETIME_UNIT_WEEK     = 1 << 4,  /* week starting on Monday */
+  DATETIME_UNIT_WEEK_SUN = 1 << 5,  /* week starting on Sunday */
+  DATETIME_UNIT_MONTH    = 1 << 6,
+  DATETIME_UNIT_YEAR     = 1 << 7,
+  DATETIME_UNIT_SUBSECOND = 1 << 8  /* %N and friends */
+} t_datetime_unit;
+
+/*
+ * How often timers refresh sub-second fields; the panel labels follow
+ * the frame clock instead.
+ */
+#define DATETIME_SUBSECOND_MS 100
+
+t_datetime_format *
+datetime_format_compile(const gchar *format);
+
+void
+datetime_format_free(t_datetime_format *program);
+
+gsize
+datetime_format_render(const t_datetime_format *program,
+    const struct tm *tm,
+    gint msec,
+    gchar *buf,
+    gsize buf_size);
+
+gchar *
+datetime_do_utf8strftime(
+    const char *format,
+    const struct tm *tm);
+
+gchar *
+datetime_format_render_utf8(const t_datetime_format *program,
+    const struct tm *tm,
+    gint msec);
+
+guint
+datetime_format_get_units(const t_datetime_format *program);
+
+gint64
+datetime_next_change(guint units,
+    gint64 time_ms,
+    const struct tm *tm);
+
+#endif /* datetime-format.h */
@@ -0,0 +1,46 @@
+/*  $Id$
+ *
+ *  Copyright (C) 2003 Choe Hwanjin(krisna@kldp.org)
+ *  Copyright (c) 2006 Remco den Breeje <remco@sx.mine.nu>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "datetime-world.h"
+#include "datetime-layout.h"
+
+/*
+ * units whose change updates what the panel shows with the given layout
+ */
+guint datetime_layout_get_units(t_layout layout,
+    guint date_units,
+    guint time_units)
+{
+  switch(layout)
+  {
+    case LAYOUT_DATE:
+      return date_units;
+    case LAYOUT_TIME:
+      return time_units;
+    case LAYOUT_WORLD:
+      return datetime_world_get_units(time_units);
+    default:
+      return date_units | time_units;
+  }
+}
@@ -0,0 +1,45 @@
+/*  $Id$
+ *
+ *  Copyright (C) 2003 Choe Hwanjin(krisna@kldp.org)
+ *  Copyright (c) 2006 Remco den Breeje <remco@sx.mine.nu>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef DATETIME_LAYOUT_H
+#define DATETIME_LAYOUT_H
+
+#include <glib.h>
+
+/*
+ * How the date, the time and the world clocks are arranged in the panel;
+ * kept apart from the plugin so code without GTK can schedule like it.
+ */
+typedef enum
+{
+  LAYOUT_DATE_TIME = 0,
+  LAYOUT_TIME_DATE,
+  LAYOUT_DATE,
+  LAYOUT_TIME,
+  LAYOUT_WORLD,  /* time, then the clocks of time_zones */
+  LAYOUT_COUNT
+} t_layout;
+
+guint
+datetime_layout_get_units(t_layout layout,
+    guint date_units,
+    guint time_units);
+
+#endif /* datetime-layout.h */
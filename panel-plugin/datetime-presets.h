@@ -0,0 +1,83 @@
+/*  $Id$
+ *
+ *  Copyright (C) 2003 Choe Hwanjin(krisna@kldp.org)
+ *  Copyright (c) 2006 Remco den Breeje <remco@sx.mine.nu>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef DATETIME_PRESETS_H
+#define DATETIME_PRESETS_H
+
+#include <glib.h>
+#include <libxfce4util/libxfce4util.h>
+
+/*
+ * The formats offered by the properties dialog, shared with the
+ * benchmark so it measures what users pick.
+ */
+typedef enum {
+
+  /* standard format item; string is replaced with an example date or time */
+  DT_COMBOBOX_ITEM_TYPE_STANDARD,
+
+  /* custom format item; text is translated */
+  DT_COMBOBOX_ITEM_TYPE_CUSTOM,
+
+  /* inactive separator */
+  DT_COMBOBOX_ITEM_TYPE_SEPARATOR,
+
+} dt_combobox_item_type;
+
+typedef struct {
+  gchar *item;
+  dt_combobox_item_type type;
+} dt_combobox_item;
+
+/*
+ * Builtin formats are derived from xfce4-panel-clock.patch by Nick Schermer.
+ */
+static const dt_combobox_item dt_combobox_date[] = {
+  { "%Y-%m-%d",       DT_COMBOBOX_ITEM_TYPE_STANDARD  },
+  { "%Y %B %d",       DT_COMBOBOX_ITEM_TYPE_STANDARD  },
+  { "---",            DT_COMBOBOX_ITEM_TYPE_SEPARATOR },  /* placeholder */
+  { "%m/%d/%Y",       DT_COMBOBOX_ITEM_TYPE_STANDARD  },
+  { "%B %d, %Y",      DT_COMBOBOX_ITEM_TYPE_STANDARD  },
+  { "%b %d, %Y",      DT_COMBOBOX_ITEM_TYPE_STANDARD  },
+  { "%A, %B %d, %Y",  DT_COMBOBOX_ITEM_TYPE_STANDARD  },
+  { "%a, %b %d, %Y",  DT_COMBOBOX_ITEM_TYPE_STANDARD  },
+  { "---",            DT_COMBOBOX_ITEM_TYPE_SEPARATOR },  /* placeholder */
+  { "%d/%m/%Y",       DT_COMBOBOX_ITEM_TYPE_STANDARD  },
+  { "%d %B %Y",       DT_COMBOBOX_ITEM_TYPE_STANDARD  },
+  { "%d %b %Y",       DT_COMBOBOX_ITEM_TYPE_STANDARD  },
+  { "%A, %d %B %Y",   DT_COMBOBOX_ITEM_TYPE_STANDARD  },
+  { "%a, %d %b %Y",   DT_COMBOBOX_ITEM_TYPE_STANDARD  },
+  { "---",            DT_COMBOBOX_ITEM_TYPE_SEPARATOR },  /* placeholder */
+  { N_("Custom..."),  DT_COMBOBOX_ITEM_TYPE_CUSTOM    }
+};
+#define DT_COMBOBOX_DATE_COUNT (sizeof(dt_combobox_date)/sizeof(dt_combobox_item))
+
+static const dt_combobox_item dt_combobox_time[] = {
+  { "%H:%M",          DT_COMBOBOX_ITEM_TYPE_STANDARD  },
+  { "%H:%M:%S",       DT_COMBOBOX_ITEM_TYPE_STANDARD  },
+  { "---",            DT_COMBOBOX_ITEM_TYPE_SEPARATOR },  /* placeholder */
+  { "%l:%M %P",       DT_COMBOBOX_ITEM_TYPE_STANDARD  },
+  { "%l:%M:%S %P",    DT_COMBOBOX_ITEM_TYPE_STANDARD  },
+  { "---",            DT_COMBOBOX_ITEM_TYPE_SEPARATOR },  /* placeholder */
+  { N_("Custom..."),  DT_COMBOBOX_ITEM_TYPE_CUSTOM    }
+};
+#define DT_COMBOBOX_TIME_COUNT (sizeof(dt_combobox_time)/sizeof(dt_combobox_item))
+
+#endif /* datetime-presets.h */
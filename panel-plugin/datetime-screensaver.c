@@ -0,0 +1,193 @@
+/*  $Id$
+ *
+ *  Copyright (C) 2003 Choe Hwanjin(krisna@kldp.org)
+ *  Copyright (c) 2006 Remco den Breeje <remco@sx.mine.nu>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+/* local includes */
+#include <string.h>
+#include <gio/gio.h>
+
+/* xfce includes */
+#include <libxfce4util/libxfce4util.h>
+
+#include "datetime-screensaver.h"
+
+struct _t_datetime_screensaver {
+  t_datetime_screensaver_func func;
+  gpointer user_data;
+  GCancellable *cancellable;
+  GDBusConnection *connection;
+  guint subscription_id;
+  gboolean active;
+};
+
+/* services sending ActiveChanged(b) when the screen is locked or blanked */
+static const gchar *screensaver_interfaces[] = {
+  "org.freedesktop.ScreenSaver",
+  "org.xfce.ScreenSaver",
+  "org.gnome.ScreenSaver",
+  "org.mate.ScreenSaver",
+  "org.cinnamon.ScreenSaver"
+};
+
+static void datetime_screensaver_set_active(t_datetime_screensaver *screensaver,
+                                            gboolean active)
+{
+  if (active == screensaver->active)
+    return;
+
+  DBG("screen saver %s", active ? "active" : "inactive");
+  screensaver->active = active;
+  screensaver->func(active, screensaver->user_data);
+}
+
+static void datetime_screensaver_active_changed(GDBusConnection *connection,
+                                                const gchar *sender_name,
+                                                const gchar *object_path,
+                                                const gchar *interface_name,
+                                                const gchar *signal_name,
+                                                GVariant *parameters,
+                                                gpointer user_data)
+{
+  t_datetime_screensaver *screensaver = user_data;
+  gboolean active;
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS(screensaver_interfaces); i++)
+  {
+    if (strcmp(interface_name, screensaver_interfaces[i]) == 0)
+      break;
+  }
+  if (i == G_N_ELEMENTS(screensaver_interfaces) ||
+      !g_variant_is_of_type(parameters, G_VARIANT_TYPE("(b)")))
+    return;
+
+  g_variant_get(parameters, "(b)", &active);
+  datetime_screensaver_set_active(screensaver, active);
+}
+
+static void datetime_screensaver_get_active_ready(GObject *source,
+                                                  GAsyncResult *result,
+                                                  gpointer user_data)
+{
+  GVariant *reply;
+  GError *error = NULL;
+  gboolean active;
+
+  /* screensaver may be gone already, then the call was cancelled */
+  reply = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source), result, &error);
+  if (reply == NULL)
+  {
+    g_error_free(error);
+    return;
+  }
+
+  /* only one of the services may be running, an active one wins */
+  g_variant_get(reply, "(b)", &active);
+  g_variant_unref(reply);
+  if (active)
+    datetime_screensaver_set_active(user_data, TRUE);
+}
+
+static void datetime_screensaver_bus_ready(GObject *source,
+                                           GAsyncResult *result,
+                                           gpointer user_data)
+{
+  t_datetime_screensaver *screensaver;
+  GDBusConnection *connection;
+  GError *error = NULL;
+  gchar *path;
+  guint i;
+
+  /* screensaver may be gone already, then the call was cancelled */
+  connection = g_bus_get_finish(result, &error);
+  if (connection == NULL)
+  {
+    DBG("no session bus: %s", error->message);
+    g_error_free(error);
+    return;
+  }
+
+  screensaver = user_data;
+  screensaver->connection = connection;
+  screensaver->subscription_id =
+    g_dbus_connection_signal_subscribe(connection, NULL, NULL, "ActiveChanged",
+                                       NULL, NULL, G_DBUS_SIGNAL_FLAGS_NONE,
+                                       datetime_screensaver_active_changed,
+                                       screensaver, NULL);
+
+  /* the session may have been locked before the plugin started */
+  for (i = 0; i < G_N_ELEMENTS(screensaver_interfaces); i++)
+  {
+    path = g_strconcat("/", screensaver_interfaces[i], NULL);
+    g_strdelimit(path, ".", '/');
+    g_dbus_connection_call(connection, screensaver_interfaces[i], path,
+                           screensaver_interfaces[i], "GetActive", NULL,
+                           G_VARIANT_TYPE("(b)"), G_DBUS_CALL_FLAGS_NO_AUTO_START,
+                           -1, screensaver->cancellable,
+                           datetime_screensaver_get_active_ready, screensaver);
+    g_free(path);
+  }
+}
+
+/*
+ * call func whenever the screen saver starts or stops
+ */
+t_datetime_screensaver * datetime_screensaver_new(t_datetime_screensaver_func func,
+                                                  gpointer user_data)
+{
+  t_datetime_screensaver *screensaver;
+
+  screensaver = g_slice_new0(t_datetime_screensaver);
+  screensaver->func = func;
+  screensaver->user_data = user_data;
+  screensaver->cancellable = g_cancellable_new();
+
+  /* don't hold up the panel while connecting */
+  g_bus_get(G_BUS_TYPE_SESSION, screensaver->cancellable,
+            datetime_screensaver_bus_ready, screensaver);
+
+  return screensaver;
+}
+
+void datetime_screensaver_free(t_datetime_screensaver *screensaver)
+{
+  if (screensaver == NULL)
+    return;
+
+  g_cancellable_cancel(screensaver->cancellable);
+  g_object_unref(screensaver->cancellable);
+
+  if (screensaver->connection != NULL)
+  {
+    g_dbus_connection_signal_unsubscribe(screensaver->connection,
+                                         screensaver->subscription_id);
+    g_object_unref(screensaver->connection);
+  }
+
+  g_slice_free(t_datetime_screensaver, screensaver);
+}
+
+gboolean datetime_screensaver_get_active(const t_datetime_screensaver *screensaver)
+{
+  return screensaver != NULL && screensaver->active;
+}
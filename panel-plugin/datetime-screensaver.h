@@ -0,0 +1,45 @@
+/*  $Id$
+ *
+ *  Copyright (C) 2003 Choe Hwanjin(krisna@kldp.org)
+ *  Copyright (c) 2006 Remco den Breeje <remco@sx.mine.nu>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef DATETIME_SCREENSAVER_H
+#define DATETIME_SCREENSAVER_H
+
+#include <glib.h>
+
+/*
+ * Follows the screen saver over D-Bus, so nothing is drawn for a locked
+ * or blanked screen.
+ */
+typedef struct _t_datetime_screensaver t_datetime_screensaver;
+
+typedef void (*t_datetime_screensaver_func)(gboolean active,
+    gpointer user_data);
+
+t_datetime_screensaver *
+datetime_screensaver_new(t_datetime_screensaver_func func,
+    gpointer user_data);
+
+void
+datetime_screensaver_free(t_datetime_screensaver *screensaver);
+
+gboolean
+datetime_screensaver_get_active(const t_datetime_screensaver *screensaver);
+
+#endif /* datetime-screensaver.h */
@@ -0,0 +1,240 @@
+/*  $Id$
+ *
+ *  Copyright (C) 2003 Choe Hwanjin(krisna@kldp.org)
+ *  Copyright (c) 2006 Remco den Breeje <remco@sx.mine.nu>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+/* local includes */
+#include <time.h>
+#ifdef HAVE_SYS_TIMERFD_H
+#include <sys/timerfd.h>
+#include <errno.h>
+#include <unistd.h>
+#endif
+
+/* xfce includes */
+#include <libxfce4util/libxfce4util.h>
+
+#include "datetime-source.h"
+
+#ifdef HAVE_SYS_TIMERFD_H
+#ifndef TFD_TIMER_CANCEL_ON_SET
+#define TFD_TIMER_CANCEL_ON_SET (1 << 1)
+#endif
+#endif
+
+/*
+ * Without timerfd, clock changes can't be detected;
+ * don't sleep longer than the old minute timer did.
+ */
+#define DATETIME_SOURCE_MAX_SLEEP_MS (60 * 1000)
+
+/* how far ahead to arm the timer when nothing is due */
+#define DATETIME_SOURCE_IDLE_MS ((gint64) 366 * 24 * 60 * 60 * 1000)
+
+typedef struct {
+  GSource source;
+  gint fd;          /* CLOCK_REALTIME timerfd, or -1 */
+  gpointer fd_tag;
+  gint64 target_ms; /* wall-clock time the source is armed for */
+} t_datetime_source;
+
+static gboolean datetime_source_check(GSource *source)
+{
+#ifdef HAVE_SYS_TIMERFD_H
+  t_datetime_source *dsource = (t_datetime_source *) source;
+  guint64 expirations;
+  gssize len;
+
+  if (dsource->fd < 0)
+    return FALSE;
+
+  if (!(g_source_query_unix_fd(source, dsource->fd_tag) & G_IO_IN))
+    return FALSE;
+
+  /* ECANCELED means the clock was set, which needs an update as well */
+  len = read(dsource->fd, &expirations, sizeof(expirations));
+  if (len < 0 && errno != ECANCELED)
+    return FALSE;
+
+  DBG("timerfd %s", len < 0 ? "canceled" : "expired");
+  return TRUE;
+#else
+  return FALSE;
+#endif
+}
+
+static gboolean datetime_source_dispatch(GSource *source,
+                                         GSourceFunc callback,
+                                         gpointer user_data)
+{
+  t_datetime_source *dsource = (t_datetime_source *) source;
+
+  /* nothing is due until the callback sets the next target */
+  g_source_set_ready_time(source, -1);
+
+  if (callback == NULL)
+    return G_SOURCE_CONTINUE;
+
+  return ((t_datetime_source_func) callback)(dsource->target_ms, user_data);
+}
+
+static void datetime_source_finalize(GSource *source)
+{
+#ifdef HAVE_SYS_TIMERFD_H
+  t_datetime_source *dsource = (t_datetime_source *) source;
+
+  if (dsource->fd >= 0)
+    close(dsource->fd);
+#endif
+}
+
+static GSourceFuncs datetime_source_funcs = {
+  NULL,
+  datetime_source_check,
+  datetime_source_dispatch,
+  datetime_source_finalize
+};
+
+GSource * datetime_source_new(void)
+{
+  GSource *source;
+  t_datetime_source *dsource;
+
+  source = g_source_new(&datetime_source_funcs, sizeof(t_datetime_source));
+  g_source_set_name(source, "datetime wall clock");
+
+  dsource = (t_datetime_source *) source;
+  dsource->fd = -1;
+  dsource->target_ms = G_MAXINT64;
+
+#ifdef HAVE_SYS_TIMERFD_H
+  dsource->fd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (dsource->fd >= 0)
+    dsource->fd_tag = g_source_add_unix_fd(source, dsource->fd, G_IO_IN);
+  else
+    DBG("timerfd_create failed, clock changes will not be noticed");
+#endif
+
+  return source;
+}
+
+/*
+ * Dispatch the source when the wall clock reaches target_ms
+ * (milliseconds since the epoch), or pass G_MAXINT64 if nothing is due;
+ * clock changes are still reported then.
+ */
+void datetime_source_set_target(GSource *source, gint64 target_ms)
+{
+  gint64 now_ms = g_get_real_time() / 1000;
+  gint64 delay_ms;
+#ifdef HAVE_SYS_TIMERFD_H
+  t_datetime_source *dsource = (t_datetime_source *) source;
+  struct itimerspec its = { { 0, 0 }, { 0, 0 } };
+#endif
+
+  ((t_datetime_source *) source)->target_ms = target_ms;
+
+#ifdef HAVE_SYS_TIMERFD_H
+  if (dsource->fd >= 0)
+  {
+    if (target_ms == G_MAXINT64)
+      target_ms = now_ms + DATETIME_SOURCE_IDLE_MS;
+
+    its.it_value.tv_sec = target_ms / 1000;
+    its.it_value.tv_nsec = (target_ms % 1000) * 1000000;
+    if (timerfd_settime(dsource->fd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET,
+                        &its, NULL) == 0)
+      return;
+
+    /* kernels before 3.0 don't know TFD_TIMER_CANCEL_ON_SET */
+    DBG("timerfd_settime failed, using a timeout instead");
+    g_source_remove_unix_fd(source, dsource->fd_tag);
+    close(dsource->fd);
+    dsource->fd = -1;
+  }
+#endif
+
+  delay_ms = CLAMP(target_ms - now_ms, 0, DATETIME_SOURCE_MAX_SLEEP_MS);
+  g_source_set_ready_time(source, g_get_monotonic_time() + delay_ms * 1000);
+}
+
+GSource * datetime_seconds_source_new(void)
+{
+  GSource *source;
+  t_datetime_source *dsource;
+
+  source = g_source_new(&datetime_source_funcs, sizeof(t_datetime_source));
+  g_source_set_name(source, "datetime second timer");
+
+  dsource = (t_datetime_source *) source;
+  dsource->fd = -1;
+  dsource->target_ms = G_MAXINT64;
+
+  return source;
+}
+
+/*
+ * Offset within the second at which GLib's second timers fire,
+ * derived from the session the same way GLib does.
+ */
+static gint64 datetime_seconds_source_perturb(void)
+{
+  static gint64 perturb = -1;
+  const gchar *session;
+
+  if (perturb >= 0)
+    return perturb;
+
+  session = g_getenv("DBUS_SESSION_BUS_ADDRESS");
+  if (session == NULL)
+    session = g_getenv("HOSTNAME");
+
+  perturb = (session != NULL) ? ABS((gint) g_str_hash(session)) % 1000000 : 0;
+  return perturb;
+}
+
+/*
+ * Dispatch the source after interval_s seconds, rounded like
+ * g_timeout_add_seconds() does, or never if interval_s is 0.
+ */
+void datetime_seconds_source_set_interval(GSource *source, guint interval_s)
+{
+  t_datetime_source *dsource = (t_datetime_source *) source;
+  gint64 expiration;
+  gint64 remainder;
+
+  if (interval_s == 0)
+  {
+    dsource->target_ms = G_MAXINT64;
+    g_source_set_ready_time(source, -1);
+    return;
+  }
+
+  expiration = g_get_monotonic_time() + (gint64) interval_s * G_USEC_PER_SEC;
+  remainder = expiration % G_USEC_PER_SEC;
+  if (remainder >= G_USEC_PER_SEC / 4)
+    expiration += G_USEC_PER_SEC;
+  expiration += datetime_seconds_source_perturb() - remainder;
+
+  dsource->target_ms = (g_get_real_time() + expiration - g_get_monotonic_time()) / 1000;
+  g_source_set_ready_time(source, expiration);
+}
@@ -0,0 +1,60 @@
+/*  $Id$
+ *
+ *  Copyright (C) 2003 Choe Hwanjin(krisna@kldp.org)
+ *  Copyright (c) 2006 Remco den Breeje <remco@sx.mine.nu>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef DATETIME_SOURCE_H
+#define DATETIME_SOURCE_H
+
+#include <glib.h>
+
+/*
+ * Callback of the sources below, set with g_source_set_callback() and a
+ * cast to GSourceFunc; target_ms is the wall-clock time the source was
+ * armed for, in milliseconds since the epoch.
+ */
+typedef gboolean (*t_datetime_source_func)(gint64 target_ms,
+    gpointer user_data);
+
+/*
+ * A GSource that dispatches when the wall clock reaches an absolute time,
+ * and immediately when the wall clock is set (date -s, NTP step, resume).
+ * Unlike g_timeout_add(), which counts on the monotonic clock,
+ * it does not go stale across clock changes.
+ * It is meant to live as long as its user and be re-armed for every
+ * boundary rather than removed and added again.
+ */
+GSource *
+datetime_source_new(void);
+
+void
+datetime_source_set_target(GSource *source,
+    gint64 target_ms);
+
+/*
+ * A re-armable GSource firing like g_timeout_add_seconds(), at the offset
+ * within the second shared by all second timers of the session.
+ */
+GSource *
+datetime_seconds_source_new(void);
+
+void
+datetime_seconds_source_set_interval(GSource *source,
+    guint interval_s);
+
+#endif /* datetime-source.h */
@@ -0,0 +1,121 @@
+/*  $Id$
+ *
+ *  Copyright (C) 2003 Choe Hwanjin(krisna@kldp.org)
+ *  Copyright (c) 2006 Remco den Breeje <remco@sx.mine.nu>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+/* local includes */
+#include <stdlib.h>
+#include <string.h>
+
+/* xfce includes */
+#include <libxfce4util/libxfce4util.h>
+
+#include "datetime-stats.h"
+
+/* set to a number of seconds to log the statistics that often */
+#define DATETIME_STATS_ENV "PANEL_DATETIME_STATS"
+
+static const gint64 late_bounds_ms[DATETIME_STATS_BUCKETS - 1] = {
+  1, 10, 100, 1000, 10000
+};
+
+void datetime_stats_reset(t_datetime_stats *stats)
+{
+  memset(stats, 0, sizeof(*stats));
+  stats->start_time = g_get_monotonic_time();
+}
+
+/*
+ * count a wakeup at time_ms which the ticker aimed at target_ms
+ */
+void datetime_stats_add_wakeup(t_datetime_stats *stats,
+                               gboolean tooltip,
+                               gint64 time_ms,
+                               gint64 target_ms)
+{
+  gint64 late_ms = time_ms - target_ms;
+  guint i;
+
+  if (tooltip)
+    stats->tooltip_wakeups++;
+  else
+    stats->wakeups++;
+
+  if (late_ms < 0)
+  {
+    stats->early++;
+    return;
+  }
+
+  for (i = 0; i < DATETIME_STATS_BUCKETS - 1; i++)
+  {
+    if (late_ms < late_bounds_ms[i])
+      break;
+  }
+  stats->late[i]++;
+  stats->max_late_ms = MAX(stats->max_late_ms, late_ms);
+}
+
+gchar * datetime_stats_to_string(const t_datetime_stats *stats)
+{
+  GString *str = g_string_new(NULL);
+  guint elapsed_s = (g_get_monotonic_time() - stats->start_time) / G_USEC_PER_SEC;
+  guint i;
+
+  g_string_append_printf(str, g_dngettext(GETTEXT_PACKAGE,
+                                          "Counted for %u second\n",
+                                          "Counted for %u seconds\n",
+                                          elapsed_s),
+                         elapsed_s);
+  g_string_append_printf(str, _("Wakeups: %u, tooltip: %u\n"),
+                         stats->wakeups, stats->tooltip_wakeups);
+
+  /* one line per bucket of the histogram */
+  for (i = 0; i < DATETIME_STATS_BUCKETS - 1; i++)
+    g_string_append_printf(str, _("Late by less than %d ms: %u\n"),
+                           (gint) late_bounds_ms[i], stats->late[i]);
+  g_string_append_printf(str, _("Late by %d ms or more: %u\n"),
+                         (gint) late_bounds_ms[i - 1], stats->late[i]);
+  g_string_append_printf(str, _("Early: %u\n"), stats->early);
+  g_string_append_printf(str, _("Late by at most %d ms\n"),
+                         (gint) MIN(stats->max_late_ms, G_MAXINT));
+
+  g_string_append_printf(str, _("Renders: %u, %d \xc2\xb5s on average\n"),
+                         stats->renders,
+                         (gint) (stats->renders > 0 ? stats->render_time / stats->renders : 0));
+  g_string_append_printf(str, _("Label updates: %u"), stats->label_updates);
+
+  return g_string_free(str, FALSE);
+}
+
+/*
+ * seconds between statistics in the log, 0 if not wanted
+ */
+guint datetime_stats_get_log_interval(void)
+{
+  const gchar *value = g_getenv(DATETIME_STATS_ENV);
+
+  if (value == NULL)
+    return 0;
+
+  return (guint) CLAMP(atoi(value), 0, 24 * 60 * 60);
+}
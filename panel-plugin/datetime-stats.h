@@ -0,0 +1,60 @@
+/*  $Id$
+ *
+ *  Copyright (C) 2003 Choe Hwanjin(krisna@kldp.org)
+ *  Copyright (c) 2006 Remco den Breeje <remco@sx.mine.nu>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef DATETIME_STATS_H
+#define DATETIME_STATS_H
+
+#include <glib.h>
+
+/* upper bounds of the lateness histogram buckets, the last one is open */
+#define DATETIME_STATS_BUCKETS 6
+
+/*
+ * What an instance costs at runtime: how often it wakes, how precisely,
+ * and how much work each wakeup does.
+ */
+typedef struct {
+  gint64 start_time;      /* monotonic, when counting started */
+  guint wakeups;          /* of the panel labels */
+  guint tooltip_wakeups;
+  guint early;            /* wakeups before the boundary, e.g. clock set back */
+  guint late[DATETIME_STATS_BUCKETS];
+  gint64 max_late_ms;
+  guint renders;
+  gint64 render_time;     /* microseconds spent rendering */
+  guint label_updates;    /* renders that changed a line */
+} t_datetime_stats;
+
+void
+datetime_stats_reset(t_datetime_stats *stats);
+
+void
+datetime_stats_add_wakeup(t_datetime_stats *stats,
+    gboolean tooltip,
+    gint64 time_ms,
+    gint64 target_ms);
+
+gchar *
+datetime_stats_to_string(const t_datetime_stats *stats);
+
+guint
+datetime_stats_get_log_interval(void);
+
+#endif /* datetime-stats.h */
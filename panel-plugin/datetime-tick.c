@@ -0,0 +1,341 @@
+/*  $Id$
+ *
+ *  Copyright (C) 2003 Choe Hwanjin(krisna@kldp.org)
+ *  Copyright (c) 2006 Remco den Breeje <remco@sx.mine.nu>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+/* local includes */
+#include <time.h>
+
+/* xfce includes */
+#include <libxfce4util/libxfce4util.h>
+
+#include "datetime-format.h"
+#include "datetime-source.h"
+#include "datetime-tick.h"
+#include "datetime-zone.h"
+
+struct _t_datetime_tick {
+  t_datetime_tick_func func;
+  gpointer user_data;
+  guint units;            /* t_datetime_unit mask */
+  gboolean power_saving;  /* use the coalesced second timer */
+  guint timer_slack;
+  gint64 next_ms;         /* next change of units, G_MAXINT64 if none */
+  gint64 target_ms;       /* next_ms of the current or last call of func */
+};
+
+typedef struct {
+  GSList *ticks;
+  GSource *source;        /* wall-clock timer of precise subscriptions */
+  GSource *coalesced_source;  /* second timer of power saving subscriptions */
+  t_datetime_zone *zone;  /* local zone at the last dispatch */
+  gint64 last_ms;         /* time of the last dispatch */
+} t_datetime_ticker;
+
+static t_datetime_ticker *ticker = NULL;
+
+static gint64 datetime_clock_get_real_time(void)
+{
+  return g_get_real_time() / 1000;
+}
+
+static const t_datetime_clock datetime_system_clock = {
+  datetime_clock_get_real_time,
+  datetime_source_new,
+  datetime_source_set_target,
+  datetime_seconds_source_new,
+  datetime_seconds_source_set_interval
+};
+
+static const t_datetime_clock *datetime_clock = &datetime_system_clock;
+
+/*
+ * Compute the interval for GLib's second timers, which all fire at the same
+ * offset within the second and are used in power saving mode.
+ * GLib may move their expiration up to a quarter of a second earlier,
+ * so round up to never wake before the display changes.
+ * Formats showing seconds are refreshed every timer_slack seconds.
+ */
+static inline guint datetime_coalesced_interval(const t_datetime_tick *tick,
+                                                const gint64 wake_interval_ms)
+{
+  if (tick->units & DATETIME_UNIT_SECOND)
+    return tick->timer_slack;
+
+  return (guint) MIN((wake_interval_ms + 250 + 999) / 1000, G_MAXINT / 1000);
+}
+
+/*
+ * Arm the shared timers for the earliest subscription;
+ * both live as long as the ticker, so this allocates nothing.
+ */
+static void datetime_tick_rearm(gint64 time_ms)
+{
+  t_datetime_tick *tick;
+  gint64 target_ms = G_MAXINT64;
+  guint interval_s = 0;
+  guint tick_interval_s;
+  GSList *li;
+
+  for (li = ticker->ticks; li != NULL; li = li->next)
+  {
+    tick = li->data;
+    if (tick->next_ms == G_MAXINT64)
+      continue;
+
+    if (tick->power_saving)
+    {
+      tick_interval_s = datetime_coalesced_interval(tick, tick->next_ms - time_ms);
+      interval_s = (interval_s == 0) ? tick_interval_s : MIN(interval_s, tick_interval_s);
+    }
+    else
+      target_ms = MIN(target_ms, tick->next_ms);
+  }
+
+  /* the wall-clock source also watches for clock changes if nothing is due */
+  datetime_clock->wall_source_set_target(ticker->source, target_ms);
+  datetime_clock->seconds_source_set_interval(ticker->coalesced_source, interval_s);
+}
+
+/*
+ * Read the clock once and pass it to every subscription that needs it.
+ * target_ms is the time the ticker was woken for; the clock is read all the
+ * same, as a wakeup may come arbitrarily late (e.g. after a suspend).
+ */
+static void datetime_tick_dispatch(gint64 target_ms)
+{
+  t_datetime_tick *tick;
+  t_datetime_zone *zone = datetime_zone_get_local();
+  gint64 time_ms = datetime_clock->get_time();
+  gboolean changed;
+  struct tm tm;
+  GSList *li;
+
+  DBG("wake %" G_GINT64_FORMAT " ms after the target",
+      target_ms == G_MAXINT64 ? 0 : time_ms - target_ms);
+
+  datetime_zone_localtime(zone, time_ms / 1000, &tm);
+
+  /*
+   * Boundaries computed before stay valid unless the clock was set back
+   * or the time zone changed.
+   */
+  changed = (zone != ticker->zone || time_ms < ticker->last_ms);
+  if (zone != ticker->zone)
+  {
+    datetime_zone_unref(ticker->zone);
+    ticker->zone = datetime_zone_ref(zone);
+  }
+  ticker->last_ms = time_ms;
+
+  for (li = ticker->ticks; li != NULL; li = li->next)
+  {
+    tick = li->data;
+
+    /* hidden instances and stopped tooltips show nothing to refresh */
+    if (tick->units == 0)
+      continue;
+
+    if (!changed && time_ms < tick->next_ms)
+      continue;
+
+    tick->target_ms = tick->next_ms;
+    tick->next_ms = datetime_next_change(tick->units, time_ms, &tm);
+    tick->func(&tm, time_ms, tick->user_data);
+  }
+
+  datetime_tick_rearm(time_ms);
+}
+
+static gboolean datetime_tick_source_cb(gint64 target_ms,
+                                        gpointer user_data)
+{
+  /* the dispatch re-arms both sources */
+  datetime_tick_dispatch(target_ms);
+  return G_SOURCE_CONTINUE;
+}
+
+static void datetime_tick_zone_changed(gpointer user_data)
+{
+  datetime_tick_dispatch(G_MAXINT64);
+}
+
+/*
+ * Subscribe to the shared ticker; func is called with the current local
+ * time whenever one of the units set by datetime_tick_schedule() changes.
+ * func must not unsubscribe.
+ */
+t_datetime_tick * datetime_tick_subscribe(t_datetime_tick_func func,
+                                          gpointer user_data)
+{
+  t_datetime_tick *tick;
+
+  if (ticker == NULL)
+  {
+    ticker = g_slice_new0(t_datetime_ticker);
+    ticker->source = datetime_clock->wall_source_new();
+    g_source_set_callback(ticker->source, (GSourceFunc) datetime_tick_source_cb, NULL, NULL);
+    g_source_attach(ticker->source, NULL);
+
+    ticker->coalesced_source = datetime_clock->seconds_source_new();
+    g_source_set_callback(ticker->coalesced_source, (GSourceFunc) datetime_tick_source_cb, NULL, NULL);
+    g_source_attach(ticker->coalesced_source, NULL);
+
+    /* the wall clock doesn't move when the time zone changes */
+    datetime_zone_watch_local(datetime_tick_zone_changed, NULL);
+  }
+
+  tick = g_slice_new0(t_datetime_tick);
+  tick->func = func;
+  tick->user_data = user_data;
+  tick->timer_slack = 1;
+  tick->next_ms = G_MAXINT64;
+  ticker->ticks = g_slist_prepend(ticker->ticks, tick);
+
+  return tick;
+}
+
+void datetime_tick_unsubscribe(t_datetime_tick *tick)
+{
+  if (tick == NULL)
+    return;
+
+  ticker->ticks = g_slist_remove(ticker->ticks, tick);
+  g_slice_free(t_datetime_tick, tick);
+
+  if (ticker->ticks != NULL)
+  {
+    datetime_tick_rearm(datetime_clock->get_time());
+    return;
+  }
+
+  /* last subscription is gone */
+  g_source_destroy(ticker->coalesced_source);
+  g_source_unref(ticker->coalesced_source);
+  g_source_destroy(ticker->source);
+  g_source_unref(ticker->source);
+  datetime_zone_unwatch_local();
+  datetime_zone_unref(ticker->zone);
+  g_slice_free(t_datetime_ticker, ticker);
+  ticker = NULL;
+}
+
+/*
+ * Set the units a subscription shows and how precisely it wants to be
+ * woken, starting from the current time.
+ */
+void datetime_tick_schedule(t_datetime_tick *tick,
+                            guint units,
+                            gboolean power_saving,
+                            guint timer_slack)
+{
+  gint64 time_ms = datetime_clock->get_time();
+  struct tm tm;
+
+  datetime_localtime(time_ms / 1000, &tm);
+
+  tick->units = units;
+  tick->power_saving = power_saving;
+  tick->timer_slack = MAX(timer_slack, 1);
+  tick->next_ms = datetime_next_change(units, time_ms, &tm);
+
+  datetime_tick_rearm(time_ms);
+}
+
+/*
+ * The boundary the ticker aimed for when it last called the subscription,
+ * e.g. to see how late the call was; may be later than the call if the
+ * clock was set back or the time zone changed.
+ */
+gint64 datetime_tick_get_target(const t_datetime_tick *tick)
+{
+  return tick->target_ms;
+}
+
+/*
+ * Install a clock, or the system clock again if clock is NULL;
+ * only possible while nothing is subscribed.
+ */
+void datetime_tick_set_clock(const t_datetime_clock *clock)
+{
+  g_return_if_fail(ticker == NULL);
+
+  datetime_clock = (clock != NULL) ? clock : &datetime_system_clock;
+}
+
+/*
+ * wall-clock time in milliseconds, as the ticker sees it
+ */
+gint64 datetime_tick_get_time(void)
+{
+  return datetime_clock->get_time();
+}
+
+/*
+ * Count the wakeups a subscription with these settings causes between
+ * start_ms and end_ms, following the same schedule the ticker uses.
+ */
+guint datetime_tick_count_wakeups(guint units,
+                                  gboolean power_saving,
+                                  guint timer_slack,
+                                  gint64 start_ms,
+                                  gint64 end_ms)
+{
+  t_datetime_tick tick = { NULL, NULL, units, power_saving, MAX(timer_slack, 1), 0, 0 };
+  t_datetime_zone *zone = datetime_zone_get_local();
+  gint64 time_ms = start_ms;
+  gint64 next_ms, step_ms;
+  guint wakeups = 0;
+  struct tm tm;
+
+  /* seconds and their fractions change at fixed steps, no need to walk them */
+  if (units & (DATETIME_UNIT_SUBSECOND | DATETIME_UNIT_SECOND))
+  {
+    step_ms = (units & DATETIME_UNIT_SUBSECOND) ? DATETIME_SUBSECOND_MS : 1000;
+    if (power_saving)
+      return (end_ms - start_ms) / ((gint64) datetime_coalesced_interval(&tick, step_ms) * 1000);
+
+    return end_ms / step_ms - start_ms / step_ms;
+  }
+
+  for (;;)
+  {
+    datetime_zone_localtime(zone, time_ms / 1000, &tm);
+    next_ms = datetime_next_change(units, time_ms, &tm);
+    if (next_ms == G_MAXINT64)
+      break;
+
+    /* a boundary that isn't ahead would never end the loop */
+    g_return_val_if_fail(next_ms > time_ms, wakeups);
+
+    if (power_saving)
+      next_ms = time_ms + (gint64) datetime_coalesced_interval(&tick, next_ms - time_ms) * 1000;
+
+    if (next_ms > end_ms)
+      break;
+
+    time_ms = next_ms;
+    wakeups++;
+  }
+
+  return wakeups;
+}
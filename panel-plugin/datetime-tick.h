@@ -0,0 +1,80 @@
+/*  $Id$
+ *
+ *  Copyright (C) 2003 Choe Hwanjin(krisna@kldp.org)
+ *  Copyright (c) 2006 Remco den Breeje <remco@sx.mine.nu>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef DATETIME_TICK_H
+#define DATETIME_TICK_H
+
+#include <time.h>
+#include <glib.h>
+
+/*
+ * Process-wide ticker shared by all plugin instances: it wakes once per
+ * boundary, computes the broken-down local time once and passes it to the
+ * subscriptions whose units changed.
+ */
+typedef struct _t_datetime_tick t_datetime_tick;
+
+typedef void (*t_datetime_tick_func)(const struct tm *tm,
+    gint64 time_ms,
+    gpointer user_data);
+
+/*
+ * Where the ticker reads the time and gets its timers from.
+ * The system clock is used unless a virtual one is installed
+ * (e.g. to replay a day in a test) before the first subscription.
+ */
+typedef struct {
+  gint64 (*get_time)(void);  /* wall-clock time in milliseconds */
+  GSource *(*wall_source_new)(void);
+  void (*wall_source_set_target)(GSource *source, gint64 target_ms);
+  GSource *(*seconds_source_new)(void);
+  void (*seconds_source_set_interval)(GSource *source, guint interval_s);
+} t_datetime_clock;
+
+void
+datetime_tick_set_clock(const t_datetime_clock *clock);
+
+gint64
+datetime_tick_get_time(void);
+
+t_datetime_tick *
+datetime_tick_subscribe(t_datetime_tick_func func,
+    gpointer user_data);
+
+void
+datetime_tick_unsubscribe(t_datetime_tick *tick);
+
+gint64
+datetime_tick_get_target(const t_datetime_tick *tick);
+
+void
+datetime_tick_schedule(t_datetime_tick *tick,
+    guint units,
+    gboolean power_saving,
+    guint timer_slack);
+
+guint
+datetime_tick_count_wakeups(guint units,
+    gboolean power_saving,
+    guint timer_slack,
+    gint64 start_ms,
+    gint64 end_ms);
+
+#endif /* datetime-tick.h */
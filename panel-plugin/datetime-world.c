@@ -0,0 +1,252 @@
+/*  $Id$
+ *
+ *  Copyright (C) 2003 Choe Hwanjin(krisna@kldp.org)
+ *  Copyright (c) 2006 Remco den Breeje <remco@sx.mine.nu>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+/* local includes */
+#include <time.h>
+#include <string.h>
+
+/* xfce includes */
+#include <libxfce4util/libxfce4util.h>
+
+#include "datetime-format.h"
+#include "datetime-zone.h"
+#include "datetime-world.h"
+
+/* between the clocks */
+#define DATETIME_WORLD_SEPARATOR " \xc2\xb7 "
+
+typedef struct {
+  gchar *label;
+  t_datetime_zone *zone;  /* NULL if the zone is unknown */
+  gchar *text;            /* last rendered, NULL to render */
+  gint64 next_ms;         /* next change of text */
+} t_world_clock;
+
+struct _t_datetime_world {
+  t_world_clock *clocks;
+  guint n_clocks;
+  gint64 last_ms;         /* time of the last render */
+  gboolean invalid;       /* return the joined text even if no clock changed */
+};
+
+/*
+ * Parse a list like "NYC=America/New_York; LON=Europe/London; Asia/Tokyo";
+ * without a label, the last part of the zone name is shown.
+ * Unknown zones are shown as such instead of the local time.
+ */
+t_datetime_world * datetime_world_new(const gchar *zones)
+{
+  t_datetime_world *world;
+  t_world_clock *clock;
+  gchar **entries;
+  gchar *entry, *identifier, *label;
+  guint i;
+
+  world = g_slice_new0(t_datetime_world);
+  world->invalid = TRUE;
+  if (zones == NULL)
+    return world;
+
+  entries = g_strsplit(zones, ";", -1);
+  world->clocks = g_new0(t_world_clock, g_strv_length(entries));
+
+  for (i = 0; entries[i] != NULL; i++)
+  {
+    entry = g_strstrip(entries[i]);
+    if (*entry == '\0')
+      continue;
+
+    identifier = strchr(entry, '=');
+    if (identifier != NULL)
+    {
+      *identifier++ = '\0';
+      label = g_strstrip(entry);
+      identifier = g_strstrip(identifier);
+    }
+    else
+    {
+      identifier = entry;
+      label = strrchr(entry, '/');
+      label = (label != NULL) ? label + 1 : entry;
+    }
+
+    clock = &world->clocks[world->n_clocks++];
+    clock->label = g_strdelimit(g_strdup(label), "_", ' ');
+    clock->zone = datetime_zone_new(identifier);
+    if (clock->zone == NULL)
+    {
+      g_warning("Unknown time zone \"%s\"", identifier);
+      clock->text = g_strdup(_("unknown zone"));
+      clock->next_ms = G_MAXINT64;
+    }
+  }
+
+  g_strfreev(entries);
+
+  return world;
+}
+
+void datetime_world_free(t_datetime_world *world)
+{
+  guint i;
+
+  if (world == NULL)
+    return;
+
+  for (i = 0; i < world->n_clocks; i++)
+  {
+    g_free(world->clocks[i].label);
+    g_free(world->clocks[i].text);
+    datetime_zone_unref(world->clocks[i].zone);
+  }
+  g_free(world->clocks);
+
+  g_slice_free(t_datetime_world, world);
+}
+
+/*
+ * render all clocks on the next call, e.g. because the format changed
+ */
+void datetime_world_invalidate(t_datetime_world *world)
+{
+  guint i;
+
+  if (world == NULL)
+    return;
+
+  world->invalid = TRUE;
+  for (i = 0; i < world->n_clocks; i++)
+  {
+    if (world->clocks[i].zone == NULL)
+      continue;
+
+    g_free(world->clocks[i].text);
+    world->clocks[i].text = NULL;
+  }
+}
+
+/*
+ * Units to wake up for so every clock showing a format with the given
+ * units is refreshed in time: zones can be offset by any number of
+ * minutes from the local one, so anything coarser than minutes
+ * is checked every minute.
+ */
+guint datetime_world_get_units(guint units)
+{
+  if (units == 0 || (units & (DATETIME_UNIT_SUBSECOND | DATETIME_UNIT_SECOND)))
+    return units;
+
+  return units | DATETIME_UNIT_MINUTE;
+}
+
+/*
+ * Render the clocks whose text may have changed since the last call,
+ * and return the joined text, or NULL if none of them changed.
+ */
+gchar * datetime_world_render(t_datetime_world *world,
+                              const t_datetime_format *program,
+                              gint64 time_ms)
+{
+  t_world_clock *clock;
+  gboolean changed;
+  guint units;
+  gchar *utf8str;
+  struct tm tm;
+  guint i;
+
+  if (world == NULL || world->n_clocks == 0 || program == NULL)
+    return NULL;
+
+  /*
+   * datetime_next_change() finds local midnight with mktime(), which only
+   * knows the local zone; look at coarser formats every hour of the zone.
+   */
+  units = datetime_format_get_units(program);
+  if (!(units & (DATETIME_UNIT_SUBSECOND | DATETIME_UNIT_SECOND |
+                 DATETIME_UNIT_MINUTE | DATETIME_UNIT_HOUR)) &&
+      units != 0)
+    units = DATETIME_UNIT_HOUR;
+
+  changed = world->invalid;
+  world->invalid = FALSE;
+
+  for (i = 0; i < world->n_clocks; i++)
+  {
+    clock = &world->clocks[i];
+    if (clock->zone == NULL)
+      continue;
+
+    /* boundaries computed before are stale if the clock was set back */
+    if (clock->text != NULL && time_ms < clock->next_ms && time_ms >= world->last_ms)
+      continue;
+
+    datetime_zone_localtime(clock->zone, time_ms / 1000, &tm);
+    clock->next_ms = datetime_next_change(units, time_ms, &tm);
+
+    utf8str = datetime_format_render_utf8(program, &tm, time_ms % 1000);
+    if (g_strcmp0(clock->text, utf8str) == 0)
+    {
+      g_free(utf8str);
+      continue;
+    }
+
+    g_free(clock->text);
+    clock->text = utf8str;
+    changed = TRUE;
+  }
+
+  world->last_ms = time_ms;
+
+  if (!changed)
+    return NULL;
+
+  return datetime_world_join(world, NULL);
+}
+
+/*
+ * Join the labelled clocks into one line; with text, every known zone
+ * shows that text instead of its time, e.g. to measure the widest line.
+ */
+gchar * datetime_world_join(const t_datetime_world *world,
+                            const gchar *text)
+{
+  const t_world_clock *clock;
+  GString *joined;
+  guint i;
+
+  if (world == NULL || world->n_clocks == 0)
+    return NULL;
+
+  joined = g_string_new(NULL);
+  for (i = 0; i < world->n_clocks; i++)
+  {
+    clock = &world->clocks[i];
+    if (i > 0)
+      g_string_append(joined, DATETIME_WORLD_SEPARATOR);
+    g_string_append_printf(joined, "%s %s", clock->label,
+                           (text != NULL && clock->zone != NULL) ? text : clock->text);
+  }
+
+  return g_string_free(joined, FALSE);
+}
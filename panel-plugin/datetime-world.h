@@ -0,0 +1,55 @@
+/*  $Id$
+ *
+ *  Copyright (C) 2003 Choe Hwanjin(krisna@kldp.org)
+ *  Copyright (c) 2006 Remco den Breeje <remco@sx.mine.nu>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef DATETIME_WORLD_H
+#define DATETIME_WORLD_H
+
+#include <glib.h>
+
+#include "datetime-format.h"
+
+/*
+ * Clocks of other time zones, e.g. "NYC 09:14 · LON 14:14 · TYO 22:14",
+ * all derived from the same wall-clock time with cached zone rules.
+ */
+typedef struct _t_datetime_world t_datetime_world;
+
+t_datetime_world *
+datetime_world_new(const gchar *zones);
+
+void
+datetime_world_free(t_datetime_world *world);
+
+void
+datetime_world_invalidate(t_datetime_world *world);
+
+guint
+datetime_world_get_units(guint units);
+
+gchar *
+datetime_world_render(t_datetime_world *world,
+    const t_datetime_format *program,
+    gint64 time_ms);
+
+gchar *
+datetime_world_join(const t_datetime_world *world,
+    const gchar *text);
+
+#endif /* datetime-world.h */
@@ -0,0 +1,805 @@
+/*  $Id$
+ *
+ *  Copyright (C) 2003 Choe Hwanjin(krisna@kldp.org)
+ *  Copyright (c) 2006 Remco den Breeje <remco@sx.mine.nu>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+/* local includes */
+#include <time.h>
+#include <string.h>
+
+/* xfce includes */
+#include <gio/gio.h>
+#include <libxfce4util/libxfce4util.h>
+
+#include "datetime-zone.h"
+
+#define DATETIME_ZONE_DEFAULT_FILE "/etc/localtime"
+#define DATETIME_ZONE_DEFAULT_DIR  "/usr/share/zoneinfo"
+
+/* longest time zone abbreviation kept from a POSIX TZ string */
+#define DATETIME_ZONE_MAX_ABBR 16
+
+#define SECS_PER_DAY (24 * 60 * 60)
+
+typedef struct {
+  gint32 utoff;           /* seconds east of UTC */
+  gboolean isdst;
+  guint abbr;             /* offset into abbrs */
+} t_zone_type;
+
+/* start or end of daylight saving time in a POSIX TZ string */
+typedef struct {
+  gchar kind;             /* 'J' (1..365, no Feb 29), 'D' (0..365) or 'M' */
+  gint month;
+  gint week;
+  gint day;
+  gint32 time;            /* seconds after local midnight */
+} t_zone_date;
+
+typedef struct {
+  gchar std_abbr[DATETIME_ZONE_MAX_ABBR];
+  gchar dst_abbr[DATETIME_ZONE_MAX_ABBR];
+  gint32 std_utoff;
+  gint32 dst_utoff;
+  gboolean has_dst;
+  t_zone_date start;
+  t_zone_date end;
+} t_zone_rule;
+
+struct _t_datetime_zone {
+  gint ref_count;
+
+  /* transitions, sorted, and the type in effect from each of them on */
+  gint64 *times;
+  guint8 *time_types;
+  guint n_times;
+
+  t_zone_type *types;
+  guint n_types;
+  gchar *abbrs;
+
+  /* leap seconds ("right/" zones): total correction from each time on */
+  gint64 *leap_times;
+  gint32 *leap_corrections;
+  guint n_leaps;
+
+  /* rule for times after the last transition, from the TZif footer */
+  t_zone_rule *rule;
+
+  /* no usable data: let libc do the conversion, only for the local zone */
+  gboolean use_libc;
+};
+
+typedef struct {
+  t_datetime_zone *zone;
+  gchar *tz;              /* value of TZ the zone was loaded for */
+  gboolean tz_set;
+  GFileMonitor *monitor;
+  t_datetime_zone_changed_func func;
+  gpointer user_data;
+} t_datetime_local_zone;
+
+static t_datetime_local_zone local_zone = { NULL, NULL, FALSE, NULL, NULL, NULL };
+
+
+
+/*
+ * calendar arithmetic on days since 1970-01-01 (proleptic Gregorian)
+ */
+static inline gint64 datetime_floor_div(gint64 a, gint64 b)
+{
+  return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+static inline gboolean datetime_is_leap_year(gint64 year)
+{
+  return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+static gint64 datetime_days_from_civil(gint64 year, gint month, gint mday)
+{
+  gint64 era, yoe, doy;
+
+  year -= (month <= 2);
+  era = datetime_floor_div(year, 400);
+  yoe = year - era * 400;
+  doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + mday - 1;
+
+  return era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy - 719468;
+}
+
+static void datetime_civil_from_days(gint64 days, gint64 *year, gint *month, gint *mday)
+{
+  gint64 era, doe, yoe, doy, mp;
+
+  days += 719468;
+  era = datetime_floor_div(days, 146097);
+  doe = days - era * 146097;
+  yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  mp = (5 * doy + 2) / 153;
+
+  *mday = (gint) (doy - (153 * mp + 2) / 5 + 1);
+  *month = (gint) (mp < 10 ? mp + 3 : mp - 9);
+  *year = yoe + era * 400 + (*month <= 2);
+}
+
+static void datetime_zone_fill_tm(gint64 time_s, gint32 utoff, gboolean isdst,
+                                  const gchar *abbr, struct tm *tm)
+{
+  gint64 local_s = time_s + utoff;
+  gint64 days = datetime_floor_div(local_s, SECS_PER_DAY);
+  gint64 secs = local_s - days * SECS_PER_DAY;
+  gint64 year;
+  gint month, mday;
+
+  datetime_civil_from_days(days, &year, &month, &mday);
+
+  tm->tm_sec = secs % 60;
+  tm->tm_min = (secs / 60) % 60;
+  tm->tm_hour = secs / 3600;
+  tm->tm_mday = mday;
+  tm->tm_mon = month - 1;
+  tm->tm_year = year - 1900;
+  tm->tm_wday = (gint) ((days % 7 + 11) % 7);  /* 1970-01-01 was a Thursday */
+  tm->tm_yday = (gint) (days - datetime_days_from_civil(year, 1, 1));
+  tm->tm_isdst = isdst;
+#ifdef HAVE_STRUCT_TM_TM_GMTOFF
+  tm->tm_gmtoff = utoff;
+#endif
+#ifdef HAVE_STRUCT_TM_TM_ZONE
+  tm->tm_zone = abbr;
+#endif
+}
+
+
+
+/*
+ * POSIX TZ strings, e.g. "CET-1CEST,M3.5.0,M10.5.0/3"
+ */
+static const gchar * datetime_zone_parse_abbr(const gchar *p, gchar *abbr)
+{
+  const gchar *start;
+  gsize len;
+
+  if (*p == '<')
+  {
+    start = ++p;
+    while (*p != '\0' && *p != '>')
+      p++;
+    if (*p != '>')
+      return NULL;
+    len = p++ - start;
+  }
+  else
+  {
+    start = p;
+    while (g_ascii_isalpha(*p))
+      p++;
+    len = p - start;
+  }
+
+  if (len < 3 || len >= DATETIME_ZONE_MAX_ABBR)
+    return NULL;
+
+  memcpy(abbr, start, len);
+  abbr[len] = '\0';
+  return p;
+}
+
+/* [+-]hh[:mm[:ss]], hours up to 167 for rule times */
+static const gchar * datetime_zone_parse_time(const gchar *p, gint32 *seconds)
+{
+  gint sign = 1;
+  gint32 value[3] = { 0, 0, 0 };
+  gint i;
+
+  if (*p == '+' || *p == '-')
+    sign = (*p++ == '-') ? -1 : 1;
+
+  for (i = 0; i < 3; i++)
+  {
+    if (i > 0)
+    {
+      if (*p != ':')
+        break;
+      p++;
+    }
+    if (!g_ascii_isdigit(*p))
+      return NULL;
+    while (g_ascii_isdigit(*p) && value[i] < 1000)
+      value[i] = value[i] * 10 + (*p++ - '0');
+  }
+
+  if (value[0] > 167 || value[1] > 59 || value[2] > 59)
+    return NULL;
+
+  *seconds = sign * (value[0] * 3600 + value[1] * 60 + value[2]);
+  return p;
+}
+
+static const gchar * datetime_zone_parse_number(const gchar *p, gint *number)
+{
+  if (!g_ascii_isdigit(*p))
+    return NULL;
+
+  *number = 0;
+  while (g_ascii_isdigit(*p) && *number < 1000)
+    *number = *number * 10 + (*p++ - '0');
+
+  return p;
+}
+
+static const gchar * datetime_zone_parse_date(const gchar *p, t_zone_date *date)
+{
+  if (*p == 'M')
+  {
+    date->kind = 'M';
+    if ((p = datetime_zone_parse_number(p + 1, &date->month)) == NULL || *p != '.' ||
+        (p = datetime_zone_parse_number(p + 1, &date->week)) == NULL || *p != '.' ||
+        (p = datetime_zone_parse_number(p + 1, &date->day)) == NULL)
+      return NULL;
+    if (date->month < 1 || date->month > 12 || date->week < 1 || date->week > 5 ||
+        date->day > 6)
+      return NULL;
+  }
+  else
+  {
+    date->kind = (*p == 'J') ? 'J' : 'D';
+    if (*p == 'J')
+      p++;
+    if ((p = datetime_zone_parse_number(p, &date->day)) == NULL)
+      return NULL;
+    if (date->day > 365 || (date->kind == 'J' && date->day < 1))
+      return NULL;
+  }
+
+  date->time = 2 * 3600;
+  if (*p == '/')
+    p = datetime_zone_parse_time(p + 1, &date->time);
+
+  return p;
+}
+
+static t_zone_rule * datetime_zone_parse_rule(const gchar *p)
+{
+  t_zone_rule rule;
+  t_zone_rule *result;
+  gint32 offset;
+
+  memset(&rule, 0, sizeof(rule));
+
+  /* POSIX offsets count west of UTC */
+  if ((p = datetime_zone_parse_abbr(p, rule.std_abbr)) == NULL ||
+      (p = datetime_zone_parse_time(p, &offset)) == NULL)
+    return NULL;
+  rule.std_utoff = -offset;
+
+  if (*p != '\0')
+  {
+    if ((p = datetime_zone_parse_abbr(p, rule.dst_abbr)) == NULL)
+      return NULL;
+    rule.has_dst = TRUE;
+    rule.dst_utoff = rule.std_utoff + 3600;
+
+    if (*p != ',' && *p != '\0')
+    {
+      if ((p = datetime_zone_parse_time(p, &offset)) == NULL)
+        return NULL;
+      rule.dst_utoff = -offset;
+    }
+
+    if (*p == '\0')
+      p = ",M3.2.0,M11.1.0";  /* the US rules, as libc assumes */
+
+    if (*p != ',' ||
+        (p = datetime_zone_parse_date(p + 1, &rule.start)) == NULL || *p != ',' ||
+        (p = datetime_zone_parse_date(p + 1, &rule.end)) == NULL)
+      return NULL;
+  }
+
+  if (*p != '\0')
+    return NULL;
+
+  result = g_new(t_zone_rule, 1);
+  *result = rule;
+  return result;
+}
+
+/* local time in seconds since the epoch at which a rule date takes effect */
+static gint64 datetime_zone_date_seconds(const t_zone_date *date, gint64 year)
+{
+  static const gint month_days[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+  gint64 days = datetime_days_from_civil(year, 1, 1);
+  gint first_wday, mday, n_days;
+
+  switch (date->kind)
+  {
+    case 'J':
+      days += date->day - 1;
+      if (date->day >= 60 && datetime_is_leap_year(year))
+        days++;
+      break;
+
+    case 'D':
+      days += date->day;
+      break;
+
+    default:
+      /* day-th weekday of the week-th week, 5 meaning the last one */
+      days = datetime_days_from_civil(year, date->month, 1);
+      first_wday = (gint) ((days % 7 + 11) % 7);
+      n_days = month_days[date->month - 1] +
+               (date->month == 2 && datetime_is_leap_year(year));
+      mday = 1 + (date->day - first_wday + 7) % 7 + (date->week - 1) * 7;
+      while (mday > n_days)
+        mday -= 7;
+      days += mday - 1;
+      break;
+  }
+
+  return days * SECS_PER_DAY + date->time;
+}
+
+static gboolean datetime_zone_rule_isdst(const t_zone_rule *rule, gint64 time_s)
+{
+  gint64 year, start_s, end_s;
+  gint month, mday;
+
+  if (!rule->has_dst)
+    return FALSE;
+
+  datetime_civil_from_days(datetime_floor_div(time_s + rule->std_utoff, SECS_PER_DAY),
+                           &year, &month, &mday);
+
+  start_s = datetime_zone_date_seconds(&rule->start, year) - rule->std_utoff;
+  end_s = datetime_zone_date_seconds(&rule->end, year) - rule->dst_utoff;
+
+  /* daylight saving time spans the turn of the year in the southern hemisphere */
+  if (start_s < end_s)
+    return time_s >= start_s && time_s < end_s;
+  else
+    return time_s < end_s || time_s >= start_s;
+}
+
+
+
+/*
+ * TZif files, see RFC 8536
+ */
+static inline guint32 datetime_zone_read32(const guchar *p)
+{
+  return ((guint32) p[0] << 24) | ((guint32) p[1] << 16) | ((guint32) p[2] << 8) | p[3];
+}
+
+static inline gint64 datetime_zone_read64(const guchar *p)
+{
+  return (gint64) (((guint64) datetime_zone_read32(p) << 32) | datetime_zone_read32(p + 4));
+}
+
+static t_datetime_zone * datetime_zone_parse_tzif(const guchar *data, gsize size)
+{
+  t_datetime_zone *zone;
+  const guchar *p = data;
+  const guchar *end = data + size;
+  guint32 isutcnt, isstdcnt, leapcnt, timecnt, typecnt, charcnt;
+  gsize time_size = 4;
+  gsize block_size;
+  const guchar *footer;
+  gchar *rule_string;
+  guint i;
+
+  for (;;)
+  {
+    if (end - p < 44 || memcmp(p, "TZif", 4) != 0)
+      return NULL;
+
+    isutcnt = datetime_zone_read32(p + 20);
+    isstdcnt = datetime_zone_read32(p + 24);
+    leapcnt = datetime_zone_read32(p + 28);
+    timecnt = datetime_zone_read32(p + 32);
+    typecnt = datetime_zone_read32(p + 36);
+    charcnt = datetime_zone_read32(p + 40);
+
+    if (typecnt == 0 || typecnt > 256 || timecnt > (1 << 20) ||
+        charcnt > (1 << 16) || leapcnt > (1 << 16) ||
+        isutcnt > typecnt || isstdcnt > typecnt)
+      return NULL;
+
+    block_size = timecnt * time_size + timecnt + typecnt * 6 + charcnt +
+                 leapcnt * (time_size + 4) + isstdcnt + isutcnt;
+    if ((gsize) (end - p - 44) < block_size)
+      return NULL;
+
+    /* skip the 32-bit data of version 2+ files and read the 64-bit data */
+    if (time_size == 4 && p[4] >= '2')
+    {
+      p += 44 + block_size;
+      time_size = 8;
+      continue;
+    }
+
+    p += 44;
+    break;
+  }
+
+  zone = g_slice_new0(t_datetime_zone);
+  zone->ref_count = 1;
+  zone->n_times = timecnt;
+  zone->times = g_new(gint64, MAX(timecnt, 1));
+  zone->time_types = g_new(guint8, MAX(timecnt, 1));
+  zone->n_types = typecnt;
+  zone->types = g_new(t_zone_type, typecnt);
+  zone->abbrs = g_malloc0(charcnt + 1);
+
+  for (i = 0; i < timecnt; i++, p += time_size)
+    zone->times[i] = (time_size == 8) ? datetime_zone_read64(p)
+                                      : (gint32) datetime_zone_read32(p);
+
+  for (i = 0; i < timecnt; i++, p++)
+  {
+    zone->time_types[i] = *p;
+    if (*p >= typecnt ||
+        (i > 0 && zone->times[i] <= zone->times[i - 1]))
+    {
+      datetime_zone_unref(zone);
+      return NULL;
+    }
+  }
+
+  for (i = 0; i < typecnt; i++, p += 6)
+  {
+    zone->types[i].utoff = (gint32) datetime_zone_read32(p);
+    zone->types[i].isdst = p[4] != 0;
+    zone->types[i].abbr = MIN(p[5], charcnt);
+  }
+
+  memcpy(zone->abbrs, p, charcnt);
+  p += charcnt;
+
+  zone->n_leaps = leapcnt;
+  zone->leap_times = g_new(gint64, MAX(leapcnt, 1));
+  zone->leap_corrections = g_new(gint32, MAX(leapcnt, 1));
+  for (i = 0; i < leapcnt; i++, p += time_size + 4)
+  {
+    zone->leap_times[i] = (time_size == 8) ? datetime_zone_read64(p)
+                                           : (gint32) datetime_zone_read32(p);
+    zone->leap_corrections[i] = (gint32) datetime_zone_read32(p + time_size);
+    if (i > 0 && zone->leap_times[i] <= zone->leap_times[i - 1])
+    {
+      datetime_zone_unref(zone);
+      return NULL;
+    }
+  }
+
+  p += isstdcnt + isutcnt;
+
+  /* version 2+ footer: "\n<POSIX TZ string>\n" */
+  if (time_size == 8 && p < end && *p == '\n')
+  {
+    footer = memchr(p + 1, '\n', end - p - 1);
+    if (footer != NULL && footer > p + 1)
+    {
+      rule_string = g_strndup((const gchar *) p + 1, footer - p - 1);
+      zone->rule = datetime_zone_parse_rule(rule_string);
+      g_free(rule_string);
+    }
+  }
+
+  return zone;
+}
+
+static t_datetime_zone * datetime_zone_new_for_file(const gchar *path)
+{
+  t_datetime_zone *zone;
+  gchar *contents;
+  gsize length;
+
+  if (!g_file_get_contents(path, &contents, &length, NULL))
+    return NULL;
+
+  zone = datetime_zone_parse_tzif((const guchar *) contents, length);
+  g_free(contents);
+
+  if (zone == NULL)
+    DBG("Can't use %s", path);
+
+  return zone;
+}
+
+/* file holding the rules for an identifier, see tzset(3) */
+static gchar * datetime_zone_get_path(const gchar *identifier)
+{
+  const gchar *tzdir;
+
+  if (identifier == NULL)
+    return g_strdup(DATETIME_ZONE_DEFAULT_FILE);
+
+  if (*identifier == ':')
+    identifier++;
+
+  if (g_path_is_absolute(identifier))
+    return g_strdup(identifier);
+
+  if (*identifier == '\0' || strstr(identifier, "..") != NULL)
+    return NULL;
+
+  tzdir = g_getenv("TZDIR");
+  return g_build_filename(tzdir != NULL ? tzdir : DATETIME_ZONE_DEFAULT_DIR,
+                          identifier, NULL);
+}
+
+/*
+ * Load the zone named like the TZ environment variable would name it:
+ * a zoneinfo name, a file name or a POSIX TZ string.
+ * NULL stands for the system default zone.
+ * Returns NULL if nothing usable is found.
+ */
+t_datetime_zone * datetime_zone_new(const gchar *identifier)
+{
+  t_datetime_zone *zone = NULL;
+  t_zone_rule *rule;
+  gchar *path;
+
+  path = datetime_zone_get_path(identifier);
+  if (path != NULL)
+  {
+    zone = datetime_zone_new_for_file(path);
+    g_free(path);
+  }
+
+  if (zone != NULL || identifier == NULL)
+    return zone;
+
+  rule = datetime_zone_parse_rule(identifier);
+  if (rule == NULL)
+  {
+    DBG("Unknown time zone %s", identifier);
+    return NULL;
+  }
+
+  zone = g_slice_new0(t_datetime_zone);
+  zone->ref_count = 1;
+  zone->rule = rule;
+
+  return zone;
+}
+
+t_datetime_zone * datetime_zone_ref(t_datetime_zone *zone)
+{
+  g_atomic_int_inc(&zone->ref_count);
+  return zone;
+}
+
+void datetime_zone_unref(t_datetime_zone *zone)
+{
+  if (zone == NULL || !g_atomic_int_dec_and_test(&zone->ref_count))
+    return;
+
+  g_free(zone->times);
+  g_free(zone->time_types);
+  g_free(zone->types);
+  g_free(zone->abbrs);
+  g_free(zone->leap_times);
+  g_free(zone->leap_corrections);
+  g_free(zone->rule);
+  g_slice_free(t_datetime_zone, zone);
+}
+
+/*
+ * Break time_s (seconds since the epoch) down to local time in zone.
+ * tm->tm_zone points into zone, so it is valid as long as zone is.
+ */
+void datetime_zone_localtime(const t_datetime_zone *zone, gint64 time_s, struct tm *tm)
+{
+  const t_zone_type *type;
+  gboolean isdst;
+  guint low, high, mid;
+  time_t timeval_s;
+  gint32 correction = 0;
+  gboolean leap = FALSE;
+  gint i;
+
+  if (zone->use_libc)
+  {
+    timeval_s = (time_t) time_s;
+    localtime_r(&timeval_s, tm);
+    return;
+  }
+
+  /*
+   * Times of "right/" zones count leap seconds: take away the ones up to
+   * time_s, and show an inserted one as second 60, like tzcode does.
+   */
+  for (i = (gint) zone->n_leaps - 1; i >= 0; i--)
+  {
+    if (time_s < zone->leap_times[i])
+      continue;
+
+    correction = zone->leap_corrections[i];
+    leap = (time_s == zone->leap_times[i] &&
+            correction > (i > 0 ? zone->leap_corrections[i - 1] : 0));
+    break;
+  }
+
+  if (zone->rule != NULL &&
+      (zone->n_times == 0 || time_s >= zone->times[zone->n_times - 1]))
+  {
+    isdst = datetime_zone_rule_isdst(zone->rule, time_s);
+    datetime_zone_fill_tm(time_s - correction,
+                          isdst ? zone->rule->dst_utoff : zone->rule->std_utoff,
+                          isdst,
+                          isdst ? zone->rule->dst_abbr : zone->rule->std_abbr,
+                          tm);
+    tm->tm_sec += leap;
+    return;
+  }
+
+  /* the first type applies before the first transition */
+  type = &zone->types[0];
+  if (zone->n_times > 0 && time_s >= zone->times[0])
+  {
+    /* last transition at or before time_s */
+    low = 0;
+    high = zone->n_times;
+    while (high - low > 1)
+    {
+      mid = low + (high - low) / 2;
+      if (zone->times[mid] <= time_s)
+        low = mid;
+      else
+        high = mid;
+    }
+    type = &zone->types[zone->time_types[low]];
+  }
+
+  datetime_zone_fill_tm(time_s - correction, type->utoff, type->isdst,
+                        zone->abbrs + type->abbr, tm);
+  tm->tm_sec += leap;
+}
+
+
+
+/*
+ * The local zone, reloaded when TZ or the file it comes from changes.
+ * These functions belong to the main thread.
+ */
+static void datetime_zone_local_changed(GFileMonitor *monitor,
+                                        GFile *file,
+                                        GFile *other_file,
+                                        GFileMonitorEvent event_type,
+                                        gpointer user_data)
+{
+  switch (event_type)
+  {
+    case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+    case G_FILE_MONITOR_EVENT_DELETED:
+    case G_FILE_MONITOR_EVENT_CREATED:
+    case G_FILE_MONITOR_EVENT_MOVED_IN:
+    case G_FILE_MONITOR_EVENT_RENAMED:
+      break;
+    default:
+      return;
+  }
+
+  DBG("local time zone changed");
+
+  datetime_zone_unref(local_zone.zone);
+  local_zone.zone = NULL;
+
+  if (local_zone.func != NULL)
+    local_zone.func(local_zone.user_data);
+}
+
+static void datetime_zone_monitor_local(void)
+{
+  GFile *file;
+  gchar *path;
+
+  if (local_zone.monitor != NULL)
+  {
+    g_file_monitor_cancel(local_zone.monitor);
+    g_object_unref(local_zone.monitor);
+    local_zone.monitor = NULL;
+  }
+
+  if (local_zone.func == NULL)
+    return;
+
+  path = datetime_zone_get_path(local_zone.tz_set ? local_zone.tz : NULL);
+  if (path == NULL)
+    return;
+
+  file = g_file_new_for_path(path);
+  local_zone.monitor = g_file_monitor_file(file, G_FILE_MONITOR_WATCH_MOVES, NULL, NULL);
+  if (local_zone.monitor != NULL)
+    g_signal_connect(local_zone.monitor, "changed",
+                     G_CALLBACK(datetime_zone_local_changed), NULL);
+  g_object_unref(file);
+  g_free(path);
+}
+
+/*
+ * Get the local zone, owned by this module; take a reference to keep it
+ * past a change.  Checking TZ is a plain getenv().
+ */
+t_datetime_zone * datetime_zone_get_local(void)
+{
+  const gchar *tz = g_getenv("TZ");
+
+  if (local_zone.zone != NULL &&
+      (tz != NULL) == local_zone.tz_set && g_strcmp0(tz, local_zone.tz) == 0)
+    return local_zone.zone;
+
+  if ((tz != NULL) != local_zone.tz_set || g_strcmp0(tz, local_zone.tz) != 0)
+  {
+    g_free(local_zone.tz);
+    local_zone.tz = g_strdup(tz);
+    local_zone.tz_set = (tz != NULL);
+    datetime_zone_monitor_local();
+  }
+
+  datetime_zone_unref(local_zone.zone);
+  local_zone.zone = datetime_zone_new(tz);
+
+  /* libc makes do with a TZ it doesn't understand too, so do as it does */
+  if (local_zone.zone == NULL)
+  {
+    local_zone.zone = g_slice_new0(t_datetime_zone);
+    local_zone.zone->ref_count = 1;
+    local_zone.zone->use_libc = TRUE;
+  }
+
+  return local_zone.zone;
+}
+
+/*
+ * Call func when the file holding the local zone changes.
+ * There is a single watcher.
+ */
+void datetime_zone_watch_local(t_datetime_zone_changed_func func, gpointer user_data)
+{
+  local_zone.func = func;
+  local_zone.user_data = user_data;
+  datetime_zone_monitor_local();
+}
+
+void datetime_zone_unwatch_local(void)
+{
+  local_zone.func = NULL;
+  local_zone.user_data = NULL;
+  datetime_zone_monitor_local();
+
+  datetime_zone_unref(local_zone.zone);
+  local_zone.zone = NULL;
+  g_free(local_zone.tz);
+  local_zone.tz = NULL;
+  local_zone.tz_set = FALSE;
+}
+
+/*
+ * localtime_r() replacement using the cached local zone
+ */
+void datetime_localtime(gint64 time_s, struct tm *tm)
+{
+  datetime_zone_localtime(datetime_zone_get_local(), time_s, tm);
+}
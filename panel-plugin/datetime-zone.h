@@ -0,0 +1,66 @@
+/*  $Id$
+ *
+ *  Copyright (C) 2003 Choe Hwanjin(krisna@kldp.org)
+ *  Copyright (c) 2006 Remco den Breeje <remco@sx.mine.nu>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef DATETIME_ZONE_H
+#define DATETIME_ZONE_H
+
+#include <time.h>
+#include <glib.h>
+
+/*
+ * Time zone rules loaded once from TZif data (or a POSIX TZ string),
+ * so converting the epoch to local time is a binary search that needs
+ * neither system calls nor libc's global time zone state.
+ * A zone is immutable; it may be used from any thread while a
+ * reference is held.
+ */
+typedef struct _t_datetime_zone t_datetime_zone;
+
+typedef void (*t_datetime_zone_changed_func)(gpointer user_data);
+
+t_datetime_zone *
+datetime_zone_new(const gchar *identifier);
+
+t_datetime_zone *
+datetime_zone_ref(t_datetime_zone *zone);
+
+void
+datetime_zone_unref(t_datetime_zone *zone);
+
+void
+datetime_zone_localtime(const t_datetime_zone *zone,
+    gint64 time_s,
+    struct tm *tm);
+
+t_datetime_zone *
+datetime_zone_get_local(void);
+
+void
+datetime_zone_watch_local(t_datetime_zone_changed_func func,
+    gpointer user_data);
+
+void
+datetime_zone_unwatch_local(void);
+
+void
+datetime_localtime(gint64 time_s,
+    struct tm *tm);
+
+#endif /* datetime-zone.h */
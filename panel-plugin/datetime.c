@@ -27,161 +27,233 @@
 /* local includes */
 #include <time.h>
 #include <string.h>
+#include <errno.h>
+#include <glib/gstdio.h>
 
 /* xfce includes */
 #include <libxfce4ui/libxfce4ui.h>
 #include <libxfce4util/libxfce4util.h>
 #include <libxfce4panel/libxfce4panel.h>
 
+#include "datetime-zone.h"
 #include "datetime.h"
 #include "datetime-dialog.h"
 
-#define DATETIME_MAX_STRLEN 256
+/* settings recorded by the setters, see datetime_settings_changed() */
+enum {
+  DATETIME_CHANGED_LAYOUT       = 1 << 0,
+  DATETIME_CHANGED_FONT         = 1 << 1,
+  DATETIME_CHANGED_DATE_FORMAT  = 1 << 2,
+  DATETIME_CHANGED_TIME_FORMAT  = 1 << 3,
+  DATETIME_CHANGED_POWER_SAVING = 1 << 4,
+  DATETIME_CHANGED_TIME_ZONES   = 1 << 5,
+  DATETIME_CHANGED_CALENDARS    = 1 << 6
+};
 
 /*
- * Compute the wake interval,
- * which is the time remaining from the current time
- * to the next larger integral multiple of the update interval.
- * Setting a timer to this value schedules the next update
- * to occur on the next second or minute
- * when the given update interval is 1000 or 60000 milliseconds, respectively.
+ * set the text of a line unless it is already showing it;
+ * takes ownership of utf8str
  */
-static inline guint datetime_wake_interval(const gint64 current_time_ms,
-                                           const guint update_interval_ms)
+static void datetime_set_line_text(t_datetime *datetime, guint line,
+                                   gchar *utf8str)
 {
-  return update_interval_ms - (current_time_ms % update_interval_ms);
+  if (datetime_display_set_text(datetime->display, line, utf8str))
+    datetime->stats.label_updates++;
 }
 
 /*
- * Get date/time string
+ * set date and time lines
  */
-gchar * datetime_do_utf8strftime(const char *format, const struct tm *tm)
+static void datetime_render(t_datetime *datetime, const struct tm *current,
+                            gint64 time_ms)
 {
-  int len;
-  gchar buf[DATETIME_MAX_STRLEN];
-  gchar *utf8str = NULL;
+  gint64 start_time = g_get_monotonic_time();
+  gchar *utf8str;
 
-  /* get formatted date/time */
-  len = strftime(buf, sizeof(buf)-1, format, tm);
-  if (len == 0)
-    return g_strdup(_("Invalid format"));
+  if (datetime->layout != LAYOUT_TIME && datetime->layout != LAYOUT_WORLD &&
+      datetime->date_program != NULL)
+  {
+    utf8str = datetime_format_render_utf8(datetime->date_program, current, time_ms % 1000);
+    datetime_set_line_text(datetime, DATE, utf8str);
+  }
 
-  buf[len] = '\0';  /* make sure nul terminated string */
-  utf8str = g_locale_to_utf8(buf, -1, NULL, NULL, NULL);
-  if(utf8str == NULL)
-    return g_strdup(_("Error"));
+  if (datetime->layout != LAYOUT_DATE && datetime->time_program != NULL)
+  {
+    utf8str = datetime_format_render_utf8(datetime->time_program, current, time_ms % 1000);
+    datetime_set_line_text(datetime, TIME, utf8str);
+  }
+
+  /* the other zones, NULL if none of their clocks changed */
+  if (datetime->layout == LAYOUT_WORLD)
+  {
+    utf8str = datetime_world_render(datetime->world, datetime->time_program, time_ms);
+    if (utf8str != NULL)
+      datetime_set_line_text(datetime, ZONES, utf8str);
+  }
+
+  datetime->stats.renders++;
+  datetime->stats.render_time += g_get_monotonic_time() - start_time;
+}
+
+static void datetime_tick_cb(const struct tm *current, gint64 time_ms,
+                             gpointer user_data)
+{
+  t_datetime *datetime = user_data;
 
-  return utf8str;
+  datetime_stats_add_wakeup(&datetime->stats, FALSE, time_ms,
+                            datetime_tick_get_target(datetime->tick));
+  datetime_render(datetime, current, time_ms);
 }
 
-/**
- *  Check whether date/time format shows seconds
+/*
+ * render sub-second fields once per frame
  */
-static gboolean datetime_format_has_seconds(const gchar *format)
+static gboolean datetime_frame_tick_cb(GtkWidget *widget,
+                                       GdkFrameClock *frame_clock,
+                                       gpointer user_data)
 {
-  static struct tm time_struct = {
-    .tm_sec   = 0,
-    .tm_min   = 0,
-    .tm_hour  = 0,
-    .tm_mday  = 1,
-    .tm_mon   = 0,
-    .tm_year  = 70, /* use 1970 so strftime() can convert '%s' */
-    .tm_wday  = 0,
-    .tm_yday  = 0,
-    .tm_isdst = 0
-  };
-  int len1;
-  int len2;
-  gchar buf1[DATETIME_MAX_STRLEN];
-  gchar buf2[DATETIME_MAX_STRLEN];
+  gint64 time_ms = datetime_tick_get_time();
+  struct tm current;
 
-  if (format == NULL)
-    return FALSE;
+  datetime_localtime(time_ms / 1000, &current);
+  datetime_render(user_data, &current, time_ms);
 
-  time_struct.tm_sec = 1;
-  len1 = strftime(buf1, sizeof(buf1)-1, format, &time_struct);
-  if (len1 == 0)
-    return FALSE;
-  buf1[len1] = '\0';
+  return G_SOURCE_CONTINUE;
+}
 
-  time_struct.tm_sec = 2;
-  len2 = strftime(buf2, sizeof(buf2)-1, format, &time_struct);
-  if (len2 == 0)
-    return FALSE;
-  buf2[len2] = '\0';
+static void datetime_frame_tick_stop(t_datetime *datetime)
+{
+  if (datetime->frame_tick_id == 0)
+    return;
 
-  return len1 != len2 || strcmp(buf1, buf2) != 0;
+  gtk_widget_remove_tick_callback(datetime->button, datetime->frame_tick_id);
+  datetime->frame_tick_id = 0;
 }
 
+static void datetime_tooltip_stop(t_datetime *datetime);
+
 /*
- * set date and time labels
+ * whether anybody can see the lines: the panel may be hidden,
+ * or the screen locked or blanked
  */
-static gboolean datetime_update_cb(gpointer user_data)
+static gboolean datetime_is_shown(t_datetime *datetime)
 {
-  t_datetime *datetime = user_data;
-
-  datetime_update(datetime);
-  return TRUE;
+  return gtk_widget_get_mapped(datetime->button) &&
+         !datetime_screensaver_get_active(datetime->screensaver);
 }
 
+/*
+ * Render the lines now and tell the shared ticker when to call again:
+ * at the next change of the units shown, or on the coalesced second
+ * timer in power saving mode.
+ * While the lines can't be seen, nothing is scheduled at all;
+ * they are rendered again as soon as they are shown.
+ * Sub-second fields are rendered in sync with the frame clock;
+ * power saving mode refreshes them with the seconds.
+ */
 void datetime_update(t_datetime *datetime)
 {
-  gint64 timeval_ms; /* wall-clock time in milliseconds */
-  time_t timeval_s; /* wall-clock time in seconds */
-  gchar *utf8str;
-  struct tm *current;
-  guint wake_interval_ms;  /* milliseconds to next update */
+  gint64 time_ms = datetime_tick_get_time();
+  guint units = datetime->update_units;
+  struct tm current;
 
-  DBG("wake");
+  datetime_localtime(time_ms / 1000, &current);
 
-  /* stop timer */
-  if (datetime->timeout_id)
+  datetime_render(datetime, &current, time_ms);
+
+  if (!datetime_is_shown(datetime))
   {
-    g_source_remove(datetime->timeout_id);
+    DBG("hidden, pausing updates");
+    datetime_frame_tick_stop(datetime);
+    datetime_tooltip_stop(datetime);
+    units = 0;
   }
-
-  timeval_ms = g_get_real_time() / 1000;
-  timeval_s = timeval_ms / 1000;
-  current = localtime(&timeval_s);
-
-  if (datetime->layout != LAYOUT_TIME &&
-      datetime->date_format != NULL && GTK_IS_LABEL(datetime->date_label))
+  else if (!(units & DATETIME_UNIT_SUBSECOND))
+    datetime_frame_tick_stop(datetime);
+  else if (datetime->power_saving)
   {
-    utf8str = datetime_do_utf8strftime(datetime->date_format, current);
-    gtk_label_set_text(GTK_LABEL(datetime->date_label), utf8str);
-    g_free(utf8str);
+    datetime_frame_tick_stop(datetime);
+    units = (units & ~DATETIME_UNIT_SUBSECOND) | DATETIME_UNIT_SECOND;
   }
+  else
+  {
+    /* each frame renders everything, the ticker has nothing left to do */
+    if (datetime->frame_tick_id == 0)
+      datetime->frame_tick_id = gtk_widget_add_tick_callback(datetime->button,
+                                                             datetime_frame_tick_cb,
+                                                             datetime, NULL);
+    units = 0;
+  }
+
+  datetime_tick_schedule(datetime->tick, units,
+                         datetime->power_saving, datetime->timer_slack);
+}
+
+/*
+ * the panel was hidden or shown, pause or catch up
+ */
+static void datetime_map_changed(GtkWidget *widget, t_datetime *datetime)
+{
+  datetime_update(datetime);
+}
+
+static void datetime_screensaver_changed(gboolean active, gpointer user_data)
+{
+  datetime_update(user_data);
+}
 
-  if (datetime->layout != LAYOUT_DATE &&
-      datetime->time_format != NULL && GTK_IS_LABEL(datetime->time_label))
+/*
+ * format shown in the tooltip, if the layout has one
+ */
+static t_datetime_format * datetime_tooltip_program(t_datetime *datetime)
+{
+  switch(datetime->layout)
   {
-    utf8str = datetime_do_utf8strftime(datetime->time_format, current);
-    gtk_label_set_text(GTK_LABEL(datetime->time_label), utf8str);
-    g_free(utf8str);
+    case LAYOUT_TIME:
+    case LAYOUT_WORLD:
+      return datetime->date_program;
+    case LAYOUT_DATE:
+      return datetime->time_program;
+    default:
+      return NULL;
   }
+}
 
-  /* Compute the time to the next update and start the timer. */
-  wake_interval_ms = datetime_wake_interval(timeval_ms, datetime->update_interval_ms);
-  datetime->timeout_id = g_timeout_add(wake_interval_ms, datetime_update_cb, datetime);
+/*
+ * stop refreshing the tooltip, it is hidden
+ */
+static void datetime_tooltip_stop(t_datetime *datetime)
+{
+  datetime_tick_schedule(datetime->tooltip_tick, 0, FALSE, 1);
+  g_free(datetime->tooltip_text);
+  datetime->tooltip_text = NULL;
 }
 
-static gboolean datetime_tooltip_timer(gpointer user_data)
+/*
+ * The tooltip's own units changed: render it with the ticker's time and
+ * let GTK query it again if it is still shown.
+ */
+static void datetime_tooltip_tick_cb(const struct tm *current, gint64 time_ms,
+                                     gpointer user_data)
 {
   t_datetime *datetime = user_data;
-  DBG("wake");
+  t_datetime_format *program = datetime_tooltip_program(datetime);
 
-  /* flag to datetime_query_tooltip that there is no longer an active timeout */
-  datetime->tooltip_timeout_id = 0;
+  datetime_stats_add_wakeup(&datetime->stats, TRUE, time_ms,
+                            datetime_tick_get_target(datetime->tooltip_tick));
 
-  /*
-   * Run datetime_query_tooltip if the mouse is still there.
-   * If it is run, it'll register *this* function to be called after another
-   * timeout. If not, *this* function won't run again.
-   */
-  gtk_widget_trigger_tooltip_query(GTK_WIDGET(datetime->button));
+  /* no query since the last refresh, the tooltip went away */
+  if (!datetime->tooltip_queried || program == NULL)
+  {
+    datetime_tooltip_stop(datetime);
+    return;
+  }
 
-  /* we don't want to automatically run again */
-  return FALSE;
+  g_free(datetime->tooltip_text);
+  datetime->tooltip_text = datetime_format_render_utf8(program, current, time_ms % 1000);
+
+  datetime->tooltip_queried = FALSE;
+  gtk_widget_trigger_tooltip_query(GTK_WIDGET(datetime->button));
 }
 
 static gboolean datetime_query_tooltip(GtkWidget *widget,
@@ -190,65 +262,65 @@ static gboolean datetime_query_tooltip(GtkWidget *widget,
                                        GtkTooltip *tooltip,
                                        t_datetime *datetime)
 {
-  gint64 timeval_ms; /* wall-clock time in milliseconds */
-  time_t timeval_s; /* wall-clock time in seconds */
-  struct tm *current;
-  gchar *utf8str;
-  gchar *format = NULL;
-  guint wake_interval_ms;  /* milliseconds to next update */
+  t_datetime_format *program = datetime_tooltip_program(datetime);
+  gint64 time_ms;
+  struct tm current;
 
-  switch(datetime->layout)
-  {
-    case LAYOUT_TIME:
-      format = datetime->date_format;
-      break;
-    case LAYOUT_DATE:
-      format = datetime->time_format;
-      break;
-    default:
-      break;
-  }
-
-  if (format == NULL)
+  if (program == NULL)
     return FALSE;
 
-  timeval_ms = g_get_real_time() / 1000;
-  timeval_s = timeval_ms / 1000;
-  current = localtime(&timeval_s);
-
-  utf8str = datetime_do_utf8strftime(format, current);
-  gtk_tooltip_set_text(tooltip, utf8str);
-  g_free(utf8str);
+  datetime->tooltip_queried = TRUE;
 
-  /* if there is no active timeout to update the tooltip, register one */
-  if (!datetime->tooltip_timeout_id)
+  /* first query: render now and refresh when the tooltip's units change */
+  if (datetime->tooltip_text == NULL)
   {
-    /*
-     * I think we can afford to inefficiently poll every
-     * second while the user keeps the mouse here.
-     */
-    wake_interval_ms = datetime_wake_interval(timeval_ms, 1000);
-    datetime->tooltip_timeout_id = g_timeout_add(wake_interval_ms,
-      datetime_tooltip_timer, datetime);
+    time_ms = datetime_tick_get_time();
+    datetime_localtime(time_ms / 1000, &current);
+    datetime->tooltip_text = datetime_format_render_utf8(program, &current, time_ms % 1000);
+    datetime_tick_schedule(datetime->tooltip_tick,
+                           datetime_format_get_units(program), FALSE, 1);
   }
 
+  gtk_tooltip_set_text(tooltip, datetime->tooltip_text);
+
   return TRUE;
 }
 
-static void on_calendar_realized(GtkWidget *widget, t_datetime *datetime)
+static gboolean datetime_tooltip_leave(GtkWidget *widget,
+                                       GdkEventCrossing *event,
+                                       t_datetime *datetime)
+{
+  datetime_tooltip_stop(datetime);
+  return FALSE;
+}
+
+static void datetime_position_calendar(t_datetime *datetime)
 {
   gint x, y;
-  GtkWidget *parent;
 
-  parent = g_object_get_data(G_OBJECT(widget), "calendar-parent");
-  xfce_panel_plugin_position_widget(datetime->plugin, widget, parent, &x, &y);
-  gtk_window_move(GTK_WINDOW(widget), x, y);
+  xfce_panel_plugin_position_widget(datetime->plugin, datetime->cal,
+                                    datetime->button, &x, &y);
+  gtk_window_move(GTK_WINDOW(datetime->cal), x, y);
+}
+
+static gboolean on_calendar_mapped(GtkWidget *widget,
+                                   GdkEvent *event,
+                                   t_datetime *datetime)
+{
+  if (datetime->cal_click_time != 0)
+  {
+    DBG("calendar mapped %" G_GINT64_FORMAT " us after the click",
+        g_get_monotonic_time() - datetime->cal_click_time);
+    datetime->cal_click_time = 0;
+  }
+
+  return FALSE;
 }
 
 static gboolean close_calendar_window(t_datetime *datetime)
 {
-  gtk_widget_destroy(datetime->cal);
-  datetime->cal = NULL;
+  /* keep it around for the next click */
+  gtk_widget_hide(datetime->cal);
 
   xfce_panel_plugin_block_autohide (XFCE_PANEL_PLUGIN (datetime->plugin), FALSE);
   gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(datetime->button), FALSE);
@@ -257,14 +329,65 @@ static gboolean close_calendar_window(t_datetime *datetime)
 }
 
 /*
- * call the gtk calendar
+ * mark the days of the shown month that have events
  */
-static GtkWidget * pop_calendar_window(t_datetime *datetime, int orientation)
+static void datetime_mark_calendar(t_datetime *datetime)
+{
+  GtkCalendar *calendar;
+  guint year, month, mday;
+  guint32 days;
+
+  if (datetime->calendar == NULL)
+    return;
+
+  calendar = GTK_CALENDAR(datetime->calendar);
+  gtk_calendar_get_date(calendar, &year, &month, NULL);
+  days = datetime_events_get_month(datetime->events, year, month + 1);
+
+  gtk_calendar_clear_marks(calendar);
+  for (mday = 1; mday <= 31; mday++)
+  {
+    if (days & (1u << mday))
+      gtk_calendar_mark_day(calendar, mday);
+  }
+}
+
+static void datetime_calendar_month_changed(GtkCalendar *calendar,
+    t_datetime *datetime)
+{
+  datetime_mark_calendar(datetime);
+}
+
+/*
+ * the events of a day, shown in its tooltip
+ */
+static gchar * datetime_calendar_detail(GtkCalendar *calendar,
+    guint year,
+    guint month,
+    guint day,
+    gpointer user_data)
+{
+  t_datetime *datetime = user_data;
+
+  return datetime_events_get_day(datetime->events, year, month + 1, day);
+}
+
+/*
+ * called once the calendar files were (re)loaded
+ */
+static void datetime_events_loaded(gpointer user_data)
+{
+  t_datetime *datetime = user_data;
+
+  datetime_mark_calendar(datetime);
+}
+
+/*
+ * build and realize the (hidden) calendar popup
+ */
+static void datetime_create_calendar(t_datetime *datetime)
 {
   GtkWidget  *window;
-  GtkWidget  *cal;
-  GtkWidget  *parent = datetime->button;
-  GdkScreen  *screen;
   GtkCalendarDisplayOptions display_options;
 
   window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
@@ -272,34 +395,77 @@ static GtkWidget * pop_calendar_window(t_datetime *datetime, int orientation)
   gtk_window_set_skip_taskbar_hint(GTK_WINDOW(window), TRUE);
   gtk_window_set_skip_pager_hint(GTK_WINDOW(window), TRUE);
   gtk_window_stick(GTK_WINDOW(window));
-  g_object_set_data(G_OBJECT(window), "calendar-parent", parent);
 
   /* set screen number */
-  screen = gtk_widget_get_screen(parent);
-  gtk_window_set_screen(GTK_WINDOW(window), screen);
+  gtk_window_set_screen(GTK_WINDOW(window), gtk_widget_get_screen(datetime->button));
 
-  cal = gtk_calendar_new();
+  datetime->calendar = gtk_calendar_new();
   display_options = GTK_CALENDAR_SHOW_HEADING |
     GTK_CALENDAR_SHOW_WEEK_NUMBERS |
     GTK_CALENDAR_SHOW_DAY_NAMES;
-  gtk_calendar_set_display_options(GTK_CALENDAR (cal), display_options);
-  gtk_container_add (GTK_CONTAINER(window), cal);
+  gtk_calendar_set_display_options(GTK_CALENDAR (datetime->calendar), display_options);
+  gtk_calendar_set_detail_func(GTK_CALENDAR(datetime->calendar),
+      datetime_calendar_detail, datetime, NULL);
+  g_signal_connect(G_OBJECT(datetime->calendar), "month-changed",
+      G_CALLBACK(datetime_calendar_month_changed), datetime);
+  gtk_container_add (GTK_CONTAINER(window), datetime->calendar);
+  gtk_widget_show(datetime->calendar);
+  datetime_mark_calendar(datetime);
 
-  g_signal_connect_after(G_OBJECT(window), "realize",
-      G_CALLBACK(on_calendar_realized),
-      datetime);
   g_signal_connect_swapped(G_OBJECT(window), "delete-event",
       G_CALLBACK(close_calendar_window),
       datetime);
   g_signal_connect_swapped(G_OBJECT(window), "focus-out-event",
       G_CALLBACK(close_calendar_window),
       datetime);
-  gtk_widget_show_all(window);
+  g_signal_connect(G_OBJECT(window), "map-event",
+      G_CALLBACK(on_calendar_mapped),
+      datetime);
+
+  datetime->cal = window;
+  gtk_widget_realize(window);
+}
+
+static gboolean datetime_create_calendar_idle(gpointer user_data)
+{
+  t_datetime *datetime = user_data;
+
+  datetime->cal_idle_id = 0;
+  if (datetime->cal == NULL)
+    datetime_create_calendar(datetime);
+
+  return FALSE;
+}
+
+/*
+ * show the calendar at today's date
+ */
+static void pop_calendar_window(t_datetime *datetime)
+{
+  GdkScreen  *screen;
+  struct tm tm;
+
+  if (datetime->cal == NULL)
+    datetime_create_calendar(datetime);
+
+  /* the panel may have moved to another screen */
+  screen = gtk_widget_get_screen(datetime->button);
+  if (gtk_window_get_screen(GTK_WINDOW(datetime->cal)) != screen)
+    gtk_window_set_screen(GTK_WINDOW(datetime->cal), screen);
+
+  /* it stays on the month the user browsed to while hidden */
+  datetime_localtime(datetime_tick_get_time() / 1000, &tm);
+  gtk_calendar_select_month(GTK_CALENDAR(datetime->calendar), tm.tm_mon, tm.tm_year + 1900);
+  gtk_calendar_select_day(GTK_CALENDAR(datetime->calendar), tm.tm_mday);
+
+  /* pick up edits of the calendar files; the marks follow once loaded */
+  datetime_events_refresh(datetime->events);
+
+  datetime_position_calendar(datetime);
+  gtk_widget_show(datetime->cal);
 
   xfce_panel_plugin_block_autohide (XFCE_PANEL_PLUGIN (datetime->plugin), TRUE);
   gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(datetime->button), TRUE);
-
-  return window;
 }
 
 /*
@@ -309,167 +475,183 @@ static gboolean datetime_clicked(GtkWidget *widget,
     GdkEventButton *event,
     t_datetime *datetime)
 {
-  gint orientation;
-
   if (event->button != 1 || event->state & GDK_CONTROL_MASK)
     return FALSE;
 
   if (datetime == NULL)
     return FALSE;
 
-  if (datetime->cal != NULL)
+  if (datetime->cal != NULL && gtk_widget_get_visible(datetime->cal))
   {
     close_calendar_window(datetime);
   }
   else
   {
-    /* get orientation before drawing the calendar */
-    orientation = xfce_panel_plugin_get_orientation(datetime->plugin);
-
-    /* draw calendar */
-    datetime->cal = pop_calendar_window(datetime,
-                                        orientation);
+    datetime->cal_click_time = g_get_monotonic_time();
+    pop_calendar_window(datetime);
   }
   return TRUE;
 }
 
-static void datetime_update_date_font(t_datetime *datetime)
+/*
+ * Reserve room for the widest text the line's format can produce with the
+ * line's current font, so the line (and the panel) keeps its size while
+ * the digits change.  The zones line shows the time format once per zone.
+ */
+static void datetime_reserve_line_size(t_datetime *datetime, guint line)
 {
-#if GTK_CHECK_VERSION (3, 16, 0)
-    GtkCssProvider *css_provider;
-    gchar * css;
-#if GTK_CHECK_VERSION (3, 20, 0)
-  PangoFontDescription *font;
-  font = pango_font_description_from_string(datetime->date_font);
-  if (G_LIKELY (font))
+  const t_datetime_format *program;
+  PangoLayout *layout;
+  struct tm tm;
+  gchar *utf8str, *p;
+  gchar digit[2] = { '0', '\0' };
+  gchar widest_digit = '0';
+  gint widest_digit_width = 0;
+  gchar *widest_text = NULL;
+  gint width;
+  gint max_width = 0;
+  guint i;
+
+  /* the fonts aren't there yet, datetime_apply_style_idle() comes back */
+  if (datetime->style_idle_id != 0)
+    return;
+
+  program = (line == DATE) ? datetime->date_program : datetime->time_program;
+
+  if (program == NULL)
   {
-    css = g_strdup_printf("label { font-family: %s; font-size: %dpt; font-style: %s; font-weight: %s }",
-                          pango_font_description_get_family (font),
-                          pango_font_description_get_size (font) / PANGO_SCALE,
-                          (pango_font_description_get_style(font) == PANGO_STYLE_ITALIC ||
-                           pango_font_description_get_style(font) == PANGO_STYLE_OBLIQUE) ? "italic" : "normal",
-                          (pango_font_description_get_weight(font) >= PANGO_WEIGHT_BOLD) ? "bold" : "normal");
-    pango_font_description_free (font);
+    datetime_display_reserve_width(datetime->display, line, 0);
+    return;
   }
-  else
-    css = g_strdup_printf("label { font: %s; }",
-#else
-    css = g_strdup_printf(".label { font: %s; }",
-#endif
-                          datetime->date_font);
-    /* Setup Gtk style */
-    DBG("css: %s",css);
-    css_provider = gtk_css_provider_new ();
-    gtk_css_provider_load_from_data (css_provider, css, strlen(css), NULL);
-    gtk_style_context_add_provider (
-        GTK_STYLE_CONTEXT (gtk_widget_get_style_context (GTK_WIDGET (datetime->date_label))),
-        GTK_STYLE_PROVIDER (css_provider),
-        GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
-    g_free(css);
-#else
-  PangoFontDescription *font;
-  font = pango_font_description_from_string(datetime->date_font);
-
-  if (G_LIKELY (font))
-  {
-    gtk_widget_override_font(datetime->date_label, font);
-    pango_font_description_free (font);
+
+  layout = datetime_display_create_layout(datetime->display, line);
+
+  /* digits of proportional fonts differ in width, find the widest one */
+  for (digit[0] = '0'; digit[0] <= '9'; digit[0]++)
+  {
+    pango_layout_set_text(layout, digit, 1);
+    pango_layout_get_pixel_size(layout, &width, NULL);
+    if (width > widest_digit_width)
+    {
+      widest_digit_width = width;
+      widest_digit = digit[0];
+    }
   }
-#endif
-}
 
-static void datetime_update_time_font(t_datetime *datetime)
-{
-#if GTK_CHECK_VERSION (3, 16, 0)
-    GtkCssProvider *css_provider;
-    gchar * css;
-#if GTK_CHECK_VERSION (3, 20, 0)
-  PangoFontDescription *font;
-  font = pango_font_description_from_string(datetime->time_font);
-  if (G_LIKELY (font))
+  /* start from the current time to get a valid time zone */
+  datetime_localtime(datetime_tick_get_time() / 1000, &tm);
+
+  /*
+   * 84 is the smallest number that walks through every combination of month
+   * and weekday names; do that once before noon and once after noon.
+   * Two-digit values are used for all fields, the digits are replaced
+   * by the widest one afterwards.
+   */
+  for (i = 0; i < 2 * 84; i++)
   {
-    css = g_strdup_printf("label { font-family: %s; font-size: %dpt; font-style: %s; font-weight: %s }",
-                          pango_font_description_get_family (font),
-                          pango_font_description_get_size (font) / PANGO_SCALE,
-                          (pango_font_description_get_style(font) == PANGO_STYLE_ITALIC ||
-                           pango_font_description_get_style(font) == PANGO_STYLE_OBLIQUE) ? "italic" : "normal",
-                          (pango_font_description_get_weight(font) >= PANGO_WEIGHT_BOLD) ? "bold" : "normal");
-    pango_font_description_free (font);
+    tm.tm_mon  = i % 12;
+    tm.tm_wday = i % 7;
+    tm.tm_mday = 28;
+    tm.tm_yday = 300;
+    tm.tm_hour = (i < 84) ? 10 : 22;
+    tm.tm_min  = 59;
+    tm.tm_sec  = 59;
+
+    utf8str = datetime_format_render_utf8(program, &tm, 0);
+    for (p = utf8str; *p != '\0'; p++)
+    {
+      if (g_ascii_isdigit(*p))
+        *p = widest_digit;
+    }
+
+    pango_layout_set_text(layout, utf8str, -1);
+    pango_layout_get_pixel_size(layout, &width, NULL);
+    if (width > max_width)
+    {
+      max_width = width;
+      g_free(widest_text);
+      widest_text = utf8str;
+    }
+    else
+      g_free(utf8str);
   }
-  else
-    css = g_strdup_printf("label { font: %s; }",
-#else
-    css = g_strdup_printf(".label { font: %s; }",
-#endif
-                          datetime->time_font);
-    /* Setup Gtk style */
-    DBG("css: %s",css);
-    css_provider = gtk_css_provider_new ();
-    gtk_css_provider_load_from_data (css_provider, css, strlen(css), NULL);
-    gtk_style_context_add_provider (
-        GTK_STYLE_CONTEXT (gtk_widget_get_style_context (GTK_WIDGET (datetime->time_label))),
-        GTK_STYLE_PROVIDER (css_provider),
-        GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
-    g_free(css);
-#else
-  PangoFontDescription *font;
-  font = pango_font_description_from_string(datetime->time_font);
-
-  if (G_LIKELY (font))
-  {
-    gtk_widget_override_font(datetime->time_label, font);
-    pango_font_description_free (font);
+
+  if (line == ZONES)
+  {
+    utf8str = datetime_world_join(datetime->world, widest_text != NULL ? widest_text : "");
+    max_width = 0;
+    if (utf8str != NULL)
+    {
+      pango_layout_set_text(layout, utf8str, -1);
+      pango_layout_get_pixel_size(layout, &max_width, NULL);
+      g_free(utf8str);
+    }
   }
-#endif
+
+  g_free(widest_text);
+  g_object_unref(layout);
+
+  datetime_display_reserve_width(datetime->display, line, max_width);
+}
+
+static void datetime_style_updated(GtkWidget *widget, t_datetime *datetime)
+{
+  datetime_reserve_line_size(datetime, DATE);
+  datetime_reserve_line_size(datetime, TIME);
+  datetime_reserve_line_size(datetime, ZONES);
 }
 
 static void datetime_set_update_interval(t_datetime *datetime)
 {
-  /* a custom date format could specify seconds */
-  gboolean date_has_seconds = datetime_format_has_seconds(datetime->date_format);
-  gboolean time_has_seconds = datetime_format_has_seconds(datetime->time_format);
-  gboolean has_seconds;
+  /* a custom format can show anything from seconds to years */
+  guint date_units = datetime_format_get_units(datetime->date_program);
+  guint time_units = datetime_format_get_units(datetime->time_program);
 
-  /* set update interval for the date/time displayed in the panel */
-  switch(datetime->layout)
-  {
-    case LAYOUT_DATE:
-      has_seconds = date_has_seconds;
-      break;
-    case LAYOUT_TIME:
-      has_seconds = time_has_seconds;
-      break;
-    default:
-      has_seconds = date_has_seconds || time_has_seconds;
-      break;
-  }
+  /* set the units whose change updates the date/time displayed in the panel */
+  datetime->update_units = datetime_layout_get_units(datetime->layout,
+                                                     date_units, time_units);
 
-  /* 1000 ms in 1 second */
-  datetime->update_interval_ms = 1000 * (has_seconds ? 1 : 60);
+  /* datetime_update() leaves precise sub-second fields to the frame clock */
+  if ((datetime->update_units & DATETIME_UNIT_SUBSECOND) && !datetime->power_saving)
+    DBG("units 0x%x, redrawn on every frame", datetime->update_units);
+  else
+    DBG("units 0x%x, %u wakeups in the next 24 hours", datetime->update_units,
+        datetime_tick_count_wakeups(datetime->update_units,
+                                    datetime->power_saving, datetime->timer_slack,
+                                    datetime_tick_get_time(),
+                                    datetime_tick_get_time() + 24 * 60 * 60 * 1000));
 }
 
 /*
- * set layout after doing some checks
+ * show and order the lines and set up the tooltip for the layout
  */
-void datetime_apply_layout(t_datetime *datetime, t_layout layout)
+static void datetime_commit_layout(t_datetime *datetime)
 {
-  if(layout < LAYOUT_COUNT)
-  {
-    datetime->layout = layout;
-  }
+  static const guint date_time[] = { DATE, TIME };
+  static const guint time_date[] = { TIME, DATE };
+  static const guint date_only[] = { DATE };
+  static const guint time_only[] = { TIME };
+  static const guint world[] = { TIME, ZONES };
 
-  /* hide labels based on layout-selection */
-  gtk_widget_show(GTK_WIDGET(datetime->time_label));
-  gtk_widget_show(GTK_WIDGET(datetime->date_label));
+  /* show lines based on layout-selection */
   switch(datetime->layout)
   {
     case LAYOUT_DATE:
-      gtk_widget_hide(GTK_WIDGET(datetime->time_label));
+      datetime_display_set_lines(datetime->display, date_only, G_N_ELEMENTS(date_only));
       break;
     case LAYOUT_TIME:
-      gtk_widget_hide(GTK_WIDGET(datetime->date_label));
+      datetime_display_set_lines(datetime->display, time_only, G_N_ELEMENTS(time_only));
+      break;
+    case LAYOUT_TIME_DATE:
+      datetime_display_set_lines(datetime->display, time_date, G_N_ELEMENTS(time_date));
+      break;
+    case LAYOUT_WORLD:
+      datetime_display_set_lines(datetime->display, world, G_N_ELEMENTS(world));
+      /* the line may show an older time than the clocks' cache */
+      datetime_world_invalidate(datetime->world);
       break;
     default:
+      datetime_display_set_lines(datetime->display, date_time, G_N_ELEMENTS(date_time));
       break;
   }
 
@@ -484,6 +666,7 @@ void datetime_apply_layout(t_datetime *datetime, t_layout layout)
   {
     case LAYOUT_DATE:
     case LAYOUT_TIME:
+    case LAYOUT_WORLD:
       gtk_widget_set_has_tooltip(GTK_WIDGET(datetime->button), TRUE);
       datetime->tooltip_handler_id = g_signal_connect(datetime->button,
                              "query-tooltip",
@@ -493,21 +676,174 @@ void datetime_apply_layout(t_datetime *datetime, t_layout layout)
     default:
       gtk_widget_set_has_tooltip(GTK_WIDGET(datetime->button), FALSE);
   }
+}
 
-  /* set order based on layout-selection */
-  switch(datetime->layout)
+/*
+ * apply the fonts deferred at startup
+ */
+static gboolean datetime_apply_style_idle(gpointer user_data)
+{
+  t_datetime *datetime = user_data;
+
+  datetime->style_idle_id = 0;
+
+  datetime_display_set_font(datetime->display, DATE, datetime->date_font);
+  datetime_display_set_font(datetime->display, TIME, datetime->time_font);
+  datetime_display_set_font(datetime->display, ZONES, datetime->time_font);
+  datetime_reserve_line_size(datetime, DATE);
+  datetime_reserve_line_size(datetime, TIME);
+  datetime_reserve_line_size(datetime, ZONES);
+
+  return FALSE;
+}
+
+#ifdef DEBUG
+static gboolean datetime_first_draw(GtkWidget *widget, cairo_t *cr, t_datetime *datetime)
+{
+  DBG("first paint %" G_GINT64_FORMAT " us after construction",
+      g_get_monotonic_time() - datetime->construct_time);
+
+  g_signal_handler_disconnect(widget, datetime->first_draw_handler_id);
+  datetime->first_draw_handler_id = 0;
+
+  return FALSE;
+}
+#endif
+
+/*
+ * Apply the settings changed since the last commit in one go:
+ * rebuild what depends on them, then render and reschedule once.
+ */
+static void datetime_settings_apply(t_datetime *datetime)
+{
+  guint changed = datetime->settings_changed;
+
+  datetime->settings_changed = 0;
+  if (datetime->settings_idle_id != 0)
   {
-    case LAYOUT_TIME_DATE:
-      gtk_box_reorder_child(GTK_BOX(datetime->box), datetime->time_label, 0);
-      gtk_box_reorder_child(GTK_BOX(datetime->box), datetime->date_label, 1);
-      break;
+    g_source_remove(datetime->settings_idle_id);
+    datetime->settings_idle_id = 0;
+  }
 
-    default:
-      gtk_box_reorder_child(GTK_BOX(datetime->box), datetime->time_label, 1);
-      gtk_box_reorder_child(GTK_BOX(datetime->box), datetime->date_label, 0);
+  /* look up the zone rules once, not on every tick */
+  if (changed & DATETIME_CHANGED_TIME_ZONES)
+  {
+    datetime_world_free(datetime->world);
+    datetime->world = datetime_world_new(datetime->time_zones);
+    datetime_display_set_text(datetime->display, ZONES, g_strdup(""));
+  }
+
+  /* the files are loaded in the background */
+  if (changed & DATETIME_CHANGED_CALENDARS)
+  {
+    datetime_events_free(datetime->events);
+    datetime->events = datetime_events_new(datetime->calendars,
+                                           datetime_events_loaded, datetime);
+    datetime_mark_calendar(datetime);
+  }
+
+  /* parse the formats once here instead of on every update */
+  if (changed & DATETIME_CHANGED_DATE_FORMAT)
+  {
+    datetime_format_free(datetime->date_program);
+    datetime->date_program = datetime_format_compile(datetime->date_format);
+    datetime_reserve_line_size(datetime, DATE);
+  }
+
+  if (changed & DATETIME_CHANGED_TIME_FORMAT)
+  {
+    datetime_format_free(datetime->time_program);
+    datetime->time_program = datetime_format_compile(datetime->time_format);
+    datetime_reserve_line_size(datetime, TIME);
+  }
+
+  /* the zones line shows the time format once per zone */
+  if (changed & (DATETIME_CHANGED_TIME_FORMAT | DATETIME_CHANGED_TIME_ZONES))
+    datetime_reserve_line_size(datetime, ZONES);
+
+  /* the fonts wait for datetime_apply_style_idle() at startup */
+  if ((changed & DATETIME_CHANGED_FONT) && datetime->style_idle_id == 0)
+  {
+    datetime_display_set_font(datetime->display, DATE, datetime->date_font);
+    datetime_display_set_font(datetime->display, TIME, datetime->time_font);
+    datetime_display_set_font(datetime->display, ZONES, datetime->time_font);
+    datetime_reserve_line_size(datetime, DATE);
+    datetime_reserve_line_size(datetime, TIME);
+    datetime_reserve_line_size(datetime, ZONES);
   }
 
-  datetime_set_update_interval(datetime);
+  if (changed & DATETIME_CHANGED_LAYOUT)
+    datetime_commit_layout(datetime);
+
+  if (changed & (DATETIME_CHANGED_LAYOUT | DATETIME_CHANGED_DATE_FORMAT |
+                 DATETIME_CHANGED_TIME_FORMAT))
+  {
+    /* render the tooltip and the other zones' clocks anew */
+    datetime_tooltip_stop(datetime);
+    datetime_world_invalidate(datetime->world);
+    datetime_set_update_interval(datetime);
+  }
+
+  datetime_update(datetime);
+}
+
+static gboolean datetime_settings_idle(gpointer user_data)
+{
+  t_datetime *datetime = user_data;
+
+  datetime->settings_idle_id = 0;
+  datetime_settings_apply(datetime);
+
+  return FALSE;
+}
+
+/*
+ * Remember what a setter changed. It is applied when the outermost
+ * transaction is committed, or at idle outside of one, so a burst of
+ * changes costs a single relayout, render and reschedule.
+ */
+static void datetime_settings_changed(t_datetime *datetime, guint changed)
+{
+  datetime->settings_changed |= changed;
+
+  if (datetime->settings_depth == 0 && datetime->settings_changed != 0 &&
+      datetime->settings_idle_id == 0)
+    datetime->settings_idle_id = g_idle_add(datetime_settings_idle, datetime);
+}
+
+/*
+ * start a transaction: the setters only record their changes until
+ * the matching datetime_settings_commit()
+ */
+void datetime_settings_begin(t_datetime *datetime)
+{
+  datetime->settings_depth++;
+}
+
+/*
+ * end a transaction; the changes are applied together at idle
+ */
+void datetime_settings_commit(t_datetime *datetime)
+{
+  g_return_if_fail(datetime->settings_depth > 0);
+
+  datetime->settings_depth--;
+  datetime_settings_changed(datetime, 0);
+}
+
+/*
+ * set layout after doing some checks
+ */
+void datetime_apply_layout(t_datetime *datetime, t_layout layout)
+{
+  if(layout < LAYOUT_COUNT)
+  {
+    if (layout != datetime->layout)
+      datetime->settings_dirty |= DATETIME_CHANGED_LAYOUT;
+    datetime->layout = layout;
+  }
+
+  datetime_settings_changed(datetime, DATETIME_CHANGED_LAYOUT);
 }
 
 /*
@@ -519,17 +855,21 @@ void datetime_apply_font(t_datetime *datetime,
 {
   if (date_font_name != NULL)
   {
+    if (g_strcmp0(date_font_name, datetime->date_font) != 0)
+      datetime->settings_dirty |= DATETIME_CHANGED_FONT;
     g_free(datetime->date_font);
     datetime->date_font = g_strdup(date_font_name);
-    datetime_update_date_font(datetime);
   }
 
   if (time_font_name != NULL)
   {
+    if (g_strcmp0(time_font_name, datetime->time_font) != 0)
+      datetime->settings_dirty |= DATETIME_CHANGED_FONT;
     g_free(datetime->time_font);
     datetime->time_font = g_strdup(time_font_name);
-    datetime_update_time_font(datetime);
   }
+
+  datetime_settings_changed(datetime, DATETIME_CHANGED_FONT);
 }
 
 /*
@@ -544,17 +884,76 @@ void datetime_apply_format(t_datetime *datetime,
 
   if (date_format != NULL)
   {
+    if (g_strcmp0(date_format, datetime->date_format) != 0)
+      datetime->settings_dirty |= DATETIME_CHANGED_DATE_FORMAT;
     g_free(datetime->date_format);
     datetime->date_format = g_strdup(date_format);
+    datetime_settings_changed(datetime, DATETIME_CHANGED_DATE_FORMAT);
   }
 
   if (time_format != NULL)
   {
+    if (g_strcmp0(time_format, datetime->time_format) != 0)
+      datetime->settings_dirty |= DATETIME_CHANGED_TIME_FORMAT;
     g_free(datetime->time_format);
     datetime->time_format = g_strdup(time_format);
+    datetime_settings_changed(datetime, DATETIME_CHANGED_TIME_FORMAT);
   }
+}
+
+/*
+ * set power saving mode and how many seconds updates may be late
+ */
+void datetime_apply_power_saving(t_datetime *datetime,
+    gboolean power_saving,
+    guint timer_slack)
+{
+  if (datetime == NULL)
+    return;
 
-  datetime_set_update_interval(datetime);
+  timer_slack = CLAMP(timer_slack, 1, 60);
+  if (power_saving != datetime->power_saving || timer_slack != datetime->timer_slack)
+    datetime->settings_dirty |= DATETIME_CHANGED_POWER_SAVING;
+
+  datetime->power_saving = power_saving;
+  datetime->timer_slack = timer_slack;
+  datetime_settings_changed(datetime, DATETIME_CHANGED_POWER_SAVING);
+}
+
+/*
+ * set the zones shown by LAYOUT_WORLD, see datetime_world_new()
+ */
+void datetime_apply_time_zones(t_datetime *datetime,
+    const gchar *time_zones)
+{
+  if (datetime == NULL || time_zones == NULL)
+    return;
+
+  if (g_strcmp0(datetime->time_zones, time_zones) == 0)
+    return;
+
+  g_free(datetime->time_zones);
+  datetime->time_zones = g_strdup(time_zones);
+  datetime->settings_dirty |= DATETIME_CHANGED_TIME_ZONES;
+  datetime_settings_changed(datetime, DATETIME_CHANGED_TIME_ZONES);
+}
+
+/*
+ * set the calendar files whose events the calendar popup shows
+ */
+void datetime_apply_calendars(t_datetime *datetime,
+    const gchar *calendars)
+{
+  if (datetime == NULL || calendars == NULL)
+    return;
+
+  if (g_strcmp0(datetime->calendars, calendars) == 0)
+    return;
+
+  g_free(datetime->calendars);
+  datetime->calendars = g_strdup(calendars);
+  datetime->settings_dirty |= DATETIME_CHANGED_CALENDARS;
+  datetime_settings_changed(datetime, DATETIME_CHANGED_CALENDARS);
 }
 
 /*
@@ -569,21 +968,37 @@ static int datetime_set_size(XfcePanelPlugin *plugin,
 }
 
 /*
- * Read the settings from the config file
+ * Read the settings from the config file; with changes_only, only apply
+ * the ones that differ from the current settings and that weren't changed
+ * here since the file was last read or written, which are kept.
+ * Returns whether any setting was applied.
  */
-static void datetime_read_rc_file(XfcePanelPlugin *plugin, t_datetime *dt)
+static gboolean datetime_read_rc_file(XfcePanelPlugin *plugin, t_datetime *dt,
+                                      gboolean changes_only)
 {
   gchar *file;
   XfceRc *rc = NULL;
   t_layout layout;
+  gboolean power_saving;
+  gint timer_slack;
   const gchar *date_font, *time_font, *date_format, *time_format;
+  const gchar *time_zones, *calendars;
+  guint keep = changes_only ? dt->settings_dirty : 0;
+  gboolean changed = FALSE;
+
+  /* one transaction for all settings */
+  datetime_settings_begin(dt);
 
   /* load defaults */
   layout = LAYOUT_DATE_TIME;
+  power_saving = FALSE;
+  timer_slack = 1;
   date_font = "Bitstream Vera Sans 8";
   time_font = "Bitstream Vera Sans 8";
   date_format = "%Y-%m-%d";
   time_format = "%H:%M";
+  time_zones = "";
+  calendars = "";
 
   /* open file */
   if((file = xfce_panel_plugin_lookup_rc_file(plugin)) != NULL)
@@ -594,25 +1009,124 @@ static void datetime_read_rc_file(XfcePanelPlugin *plugin, t_datetime *dt)
     if(rc != NULL)
     {
       layout      = xfce_rc_read_int_entry(rc, "layout", layout);
+      power_saving = xfce_rc_read_bool_entry(rc, "power_saving", power_saving);
+      timer_slack = xfce_rc_read_int_entry(rc, "timer_slack", timer_slack);
       date_font   = xfce_rc_read_entry(rc, "date_font", date_font);
       time_font   = xfce_rc_read_entry(rc, "time_font", time_font);
       date_format = xfce_rc_read_entry(rc, "date_format", date_format);
       time_format = xfce_rc_read_entry(rc, "time_format", time_format);
+      time_zones  = xfce_rc_read_entry(rc, "time_zones", time_zones);
+      calendars   = xfce_rc_read_entry(rc, "calendars", calendars);
     }
   }
 
-  date_font   = g_strdup(date_font);
-  time_font   = g_strdup(time_font);
-  date_format = g_strdup(date_format);
-  time_format = g_strdup(time_format);
+  /* a missing file has nothing to take over */
+  if (changes_only && rc == NULL)
+  {
+    datetime_settings_commit(dt);
+    return FALSE;
+  }
+
+  /* as datetime_apply_power_saving() would, so it compares equal */
+  timer_slack = CLAMP(timer_slack, 1, 60);
+
+  if (changes_only)
+  {
+    /* NULL leaves a font or format as it is */
+    if (g_strcmp0(date_font, dt->date_font) == 0 || (keep & DATETIME_CHANGED_FONT))
+      date_font = NULL;
+    if (g_strcmp0(time_font, dt->time_font) == 0 || (keep & DATETIME_CHANGED_FONT))
+      time_font = NULL;
+    if (g_strcmp0(date_format, dt->date_format) == 0 || (keep & DATETIME_CHANGED_DATE_FORMAT))
+      date_format = NULL;
+    if (g_strcmp0(time_format, dt->time_format) == 0 || (keep & DATETIME_CHANGED_TIME_FORMAT))
+      time_format = NULL;
+  }
+
+  /* set values in dt struct, which keeps copies of the strings owned by rc */
+  if (!changes_only ||
+      (g_strcmp0(time_zones, dt->time_zones) != 0 && !(keep & DATETIME_CHANGED_TIME_ZONES)))
+  {
+    datetime_apply_time_zones(dt, time_zones);
+    changed = TRUE;
+  }
+  if (!changes_only ||
+      (g_strcmp0(calendars, dt->calendars) != 0 && !(keep & DATETIME_CHANGED_CALENDARS)))
+  {
+    datetime_apply_calendars(dt, calendars);
+    changed = TRUE;
+  }
+  if (!changes_only || (layout != dt->layout && !(keep & DATETIME_CHANGED_LAYOUT)))
+  {
+    datetime_apply_layout(dt, layout);
+    changed = TRUE;
+  }
+  if (!changes_only ||
+      ((power_saving != dt->power_saving || (guint) timer_slack != dt->timer_slack) &&
+       !(keep & DATETIME_CHANGED_POWER_SAVING)))
+  {
+    datetime_apply_power_saving(dt, power_saving, timer_slack);
+    changed = TRUE;
+  }
+  if (date_font != NULL || time_font != NULL)
+  {
+    datetime_apply_font(dt, date_font, time_font);
+    changed = TRUE;
+  }
+  if (date_format != NULL || time_format != NULL)
+  {
+    datetime_apply_format(dt, date_format, time_format);
+    changed = TRUE;
+  }
 
   if(rc != NULL)
     xfce_rc_close(rc);
 
-  /* set values in dt struct */
-  datetime_apply_layout(dt, layout);
-  datetime_apply_font(dt, date_font, time_font);
-  datetime_apply_format(dt, date_format, time_format);
+  datetime_settings_commit(dt);
+
+  /* the settings match the file now, except for the ones kept */
+  dt->settings_dirty = keep;
+
+  return changed;
+}
+
+/*
+ * The rc file changed, e.g. written by another program or by our own
+ * datetime_write_rc_file(); apply what differs, except for the settings
+ * changed in the dialog that aren't saved yet.
+ */
+static void datetime_rc_file_changed(GFileMonitor *monitor,
+                                     GFile *file,
+                                     GFile *other_file,
+                                     GFileMonitorEvent event_type,
+                                     t_datetime *dt)
+{
+  if (event_type != G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT &&
+      event_type != G_FILE_MONITOR_EVENT_CREATED)
+    return;
+
+  /* applied at idle */
+  if (datetime_read_rc_file(dt->plugin, dt, TRUE))
+    DBG("settings changed on disk");
+}
+
+static void datetime_monitor_rc_file(XfcePanelPlugin *plugin, t_datetime *dt)
+{
+  GFile *file;
+  gchar *path;
+
+  path = xfce_panel_plugin_save_location(plugin, FALSE);
+  if (path == NULL)
+    return;
+
+  file = g_file_new_for_path(path);
+  dt->rc_monitor = g_file_monitor_file(file, G_FILE_MONITOR_NONE, NULL, NULL);
+  if (dt->rc_monitor != NULL)
+    g_signal_connect(dt->rc_monitor, "changed",
+                     G_CALLBACK(datetime_rc_file_changed), dt);
+
+  g_object_unref(file);
+  g_free(path);
 }
 
 /*
@@ -620,51 +1134,60 @@ static void datetime_read_rc_file(XfcePanelPlugin *plugin, t_datetime *dt)
  */
 void datetime_write_rc_file(XfcePanelPlugin *plugin, t_datetime *dt)
 {
-  char *file;
+  char *file, *tmp_file;
   XfceRc *rc;
+  gint saved_errno;
+
+  /* nothing changed since the file was read or written */
+  if (dt->settings_dirty == 0)
+    return;
 
   if(!(file = xfce_panel_plugin_save_location(plugin, TRUE)))
     return;
 
-  rc = xfce_rc_simple_open(file, FALSE);
-  g_free(file);
+  /* take over what others wrote meanwhile, unless it was changed here too */
+  datetime_read_rc_file(plugin, dt, TRUE);
+
+  /* write a copy and move it over the file, so readers never see half of it */
+  tmp_file = g_strconcat(file, ".tmp", NULL);
+  g_unlink(tmp_file);
+  rc = xfce_rc_simple_open(tmp_file, FALSE);
 
   if(rc != NULL)
   {
     xfce_rc_write_int_entry(rc, "layout", dt->layout);
+    xfce_rc_write_bool_entry(rc, "power_saving", dt->power_saving);
+    xfce_rc_write_int_entry(rc, "timer_slack", dt->timer_slack);
     xfce_rc_write_entry(rc, "date_font", dt->date_font);
     xfce_rc_write_entry(rc, "time_font", dt->time_font);
     xfce_rc_write_entry(rc, "date_format", dt->date_format);
     xfce_rc_write_entry(rc, "time_format", dt->time_format);
+    xfce_rc_write_entry(rc, "time_zones", dt->time_zones);
+    xfce_rc_write_entry(rc, "calendars", dt->calendars);
 
     xfce_rc_close(rc);
+
+    if (g_rename(tmp_file, file) == 0)
+      dt->settings_dirty = 0;
+    else
+    {
+      saved_errno = errno;
+      g_unlink(tmp_file);
+      g_warning("Unable to save the settings to %s: %s", file, g_strerror(saved_errno));
+    }
   }
 
+  g_free(tmp_file);
+  g_free(file);
 }
 
 /*
- * change widgets orientation when the panel orientation changes
+ * rotate the lines when the panel orientation changes
  */
 static void datetime_set_mode(XfcePanelPlugin *plugin, XfcePanelPluginMode mode, t_datetime *datetime)
 {
-  GtkOrientation orientation = (mode == XFCE_PANEL_PLUGIN_MODE_VERTICAL) ?
-    GTK_ORIENTATION_VERTICAL : GTK_ORIENTATION_HORIZONTAL;
-  if (orientation == GTK_ORIENTATION_VERTICAL)
-  {
-    gtk_orientable_set_orientation(GTK_ORIENTABLE(datetime->box), GTK_ORIENTATION_HORIZONTAL);
-    gtk_label_set_angle(GTK_LABEL(datetime->time_label), -90);
-    gtk_label_set_angle(GTK_LABEL(datetime->date_label), -90);
-    gtk_box_reorder_child(GTK_BOX(datetime->box), datetime->time_label, 0);
-    gtk_box_reorder_child(GTK_BOX(datetime->box), datetime->date_label, 1);
-  }
-  else
-  {
-    gtk_orientable_set_orientation(GTK_ORIENTABLE(datetime->box), GTK_ORIENTATION_VERTICAL);
-    gtk_label_set_angle(GTK_LABEL(datetime->time_label), 0);
-    gtk_label_set_angle(GTK_LABEL(datetime->date_label), 0);
-    gtk_box_reorder_child(GTK_BOX(datetime->box), datetime->date_label, 0);
-    gtk_box_reorder_child(GTK_BOX(datetime->box), datetime->time_label, 1);
-  }
+  datetime_display_set_vertical(datetime->display,
+                                mode == XFCE_PANEL_PLUGIN_MODE_VERTICAL);
 }
 
 /*
@@ -679,38 +1202,56 @@ static void datetime_create_widget(t_datetime * datetime)
   datetime->button = xfce_panel_create_toggle_button();
   gtk_widget_show(datetime->button);
 
-  /* create a box which can be easily adapted to the panel orientation */
-  datetime->box = gtk_box_new(GTK_ORIENTATION_VERTICAL, 0);
-
-  gtk_widget_show(datetime->box);
-  gtk_container_add(GTK_CONTAINER(datetime->button), datetime->box);
+  /* one widget draws the date, time and zones lines */
+  datetime->display = datetime_display_new();
+  gtk_widget_show(datetime_display_get_widget(datetime->display));
+  gtk_container_add(GTK_CONTAINER(datetime->button),
+                    datetime_display_get_widget(datetime->display));
 
-  /* create time and date lines */
-  datetime->time_label = gtk_label_new("");
-  datetime->date_label = gtk_label_new("");
-  gtk_label_set_justify(GTK_LABEL(datetime->time_label), GTK_JUSTIFY_CENTER);
-  gtk_label_set_justify(GTK_LABEL(datetime->date_label), GTK_JUSTIFY_CENTER);
-
-  /* add time and date lines to the box */
-  gtk_box_pack_start(GTK_BOX(datetime->box),
-      datetime->time_label, TRUE, FALSE, 0);
-  gtk_box_pack_start(GTK_BOX(datetime->box),
-      datetime->date_label, TRUE, FALSE, 0);
+  /* screen readers name the button after the text it shows */
+  atk_object_add_relationship(gtk_widget_get_accessible(datetime->button),
+      ATK_RELATION_LABELLED_BY,
+      gtk_widget_get_accessible(datetime_display_get_widget(datetime->display)));
 
   /* connect widget signals to functions */
   g_signal_connect(datetime->button, "button-press-event",
       G_CALLBACK(datetime_clicked), datetime);
+  g_signal_connect(datetime->button, "leave-notify-event",
+      G_CALLBACK(datetime_tooltip_leave), datetime);
+  g_signal_connect(datetime->button, "map",
+      G_CALLBACK(datetime_map_changed), datetime);
+  g_signal_connect(datetime->button, "unmap",
+      G_CALLBACK(datetime_map_changed), datetime);
+  g_signal_connect(datetime_display_get_widget(datetime->display), "style-updated",
+      G_CALLBACK(datetime_style_updated), datetime);
 
   /* set orientation according to the panel orientation */
   datetime_set_mode(datetime->plugin, (XfcePanelPluginMode)orientation, datetime);
 }
 
+/*
+ * write the statistics to the log, see datetime_stats_get_log_interval()
+ */
+static gboolean datetime_stats_log(gpointer user_data)
+{
+  t_datetime *datetime = user_data;
+  gchar *str;
+
+  str = datetime_stats_to_string(&datetime->stats);
+  g_message("%s-%d: %s", xfce_panel_plugin_get_name(datetime->plugin),
+            xfce_panel_plugin_get_unique_id(datetime->plugin), str);
+  g_free(str);
+
+  return TRUE;
+}
+
 /*
  * create datetime plugin
  */
 static t_datetime * datetime_new(XfcePanelPlugin *plugin)
 {
   t_datetime * datetime;
+  guint interval;
 
   DBG("Starting datetime panel plugin");
 
@@ -719,15 +1260,45 @@ static t_datetime * datetime_new(XfcePanelPlugin *plugin)
 
   /* store plugin reference */
   datetime->plugin = plugin;
+#ifdef DEBUG
+  datetime->construct_time = g_get_monotonic_time();
+#endif
+  datetime_stats_reset(&datetime->stats);
+
+  /* don't wake up for a locked or blanked screen */
+  datetime->screensaver = datetime_screensaver_new(datetime_screensaver_changed, datetime);
+
+  /* share one wall-clock timer with the other instances */
+  datetime->tick = datetime_tick_subscribe(datetime_tick_cb, datetime);
+  datetime->tooltip_tick = datetime_tick_subscribe(datetime_tooltip_tick_cb, datetime);
 
   /* call widget-create function */
   datetime_create_widget(datetime);
+#ifdef DEBUG
+  datetime->first_draw_handler_id = g_signal_connect_after(datetime->button, "draw",
+      G_CALLBACK(datetime_first_draw), datetime);
+#endif
+
+  /*
+   * Show the text right away in the theme's font;
+   * parsing the fonts and measuring the lines waits for idle.
+   */
+  datetime->style_idle_id = g_idle_add(datetime_apply_style_idle, datetime);
 
   /* load settings (default values if non-av) */
-  datetime_read_rc_file(plugin, datetime);
+  datetime_read_rc_file(plugin, datetime, FALSE);
+  datetime_monitor_rc_file(plugin, datetime);
 
-  /* set date and time labels */
-  datetime_update(datetime);
+  /* set date and time lines now, not at idle */
+  datetime_settings_apply(datetime);
+
+  /* build the calendar popup once the panel has settled */
+  datetime->cal_idle_id = g_idle_add_full(G_PRIORITY_LOW, datetime_create_calendar_idle,
+                                          datetime, NULL);
+
+  interval = datetime_stats_get_log_interval();
+  if (interval > 0)
+    datetime->stats_log_id = g_timeout_add_seconds(interval, datetime_stats_log, datetime);
 
   return datetime;
 }
@@ -737,20 +1308,57 @@ static t_datetime * datetime_new(XfcePanelPlugin *plugin)
  */
 static void datetime_free(XfcePanelPlugin *plugin, t_datetime *datetime)
 {
+  GtkWidget *dlg;
+
+  /* the dialog refers to datetime */
+  dlg = g_object_get_data(G_OBJECT(plugin), "dialog");
+  if (dlg != NULL)
+  {
+    g_object_set_data(G_OBJECT(plugin), "dialog", NULL);
+    gtk_widget_destroy(dlg);
+  }
+
   /* stop timeouts */
-  if (datetime->timeout_id != 0)
-    g_source_remove(datetime->timeout_id);
-  if (datetime->tooltip_timeout_id != 0)
-    g_source_remove(datetime->tooltip_timeout_id);
+  if (datetime->format_preview_timeout_id != 0)
+    g_source_remove(datetime->format_preview_timeout_id);
+  if (datetime->stats_timeout_id != 0)
+    g_source_remove(datetime->stats_timeout_id);
+  datetime_tick_unsubscribe(datetime->tooltip_tick);
+  datetime_tick_unsubscribe(datetime->tick);
+  datetime_screensaver_free(datetime->screensaver);
+  if (datetime->rc_monitor != NULL)
+  {
+    g_file_monitor_cancel(datetime->rc_monitor);
+    g_object_unref(datetime->rc_monitor);
+  }
+  if (datetime->cal_idle_id != 0)
+    g_source_remove(datetime->cal_idle_id);
+  if (datetime->style_idle_id != 0)
+    g_source_remove(datetime->style_idle_id);
+  if (datetime->stats_log_id != 0)
+    g_source_remove(datetime->stats_log_id);
+  if (datetime->settings_idle_id != 0)
+    g_source_remove(datetime->settings_idle_id);
 
   /* destroy widget */
+  datetime_frame_tick_stop(datetime);
+  if (datetime->cal != NULL)
+    gtk_widget_destroy(datetime->cal);
   gtk_widget_destroy(datetime->button);
 
   /* cleanup */
+  datetime_display_free(datetime->display);
   g_free(datetime->date_font);
   g_free(datetime->time_font);
   g_free(datetime->date_format);
   g_free(datetime->time_format);
+  g_free(datetime->time_zones);
+  datetime_world_free(datetime->world);
+  g_free(datetime->calendars);
+  datetime_events_free(datetime->events);
+  datetime_format_free(datetime->date_program);
+  datetime_format_free(datetime->time_program);
+  g_free(datetime->tooltip_text);
 
   g_slice_free(t_datetime, datetime);
 }
@@ -22,32 +22,41 @@
 #ifndef DATETIME_H
 #define DATETIME_H
 
+#include <gtk/gtk.h>
+#include <libxfce4panel/libxfce4panel.h>
+
+#include "datetime-display.h"
+#include "datetime-events.h"
+#include "datetime-format.h"
+#include "datetime-layout.h"
+#include "datetime-screensaver.h"
+#include "datetime-stats.h"
+#include "datetime-tick.h"
+#include "datetime-world.h"
+
 /* enums */
 enum {
   DATE = 0,
-  TIME
+  TIME,
+  ZONES  /* lines of the display, see datetime_commit_layout() */
 };
 
 /* typedefs */
-typedef enum
-{
-  LAYOUT_DATE_TIME = 0,
-  LAYOUT_TIME_DATE,
-  LAYOUT_DATE,
-  LAYOUT_TIME,
-  LAYOUT_COUNT
-} t_layout;
-
 typedef struct {
   XfcePanelPlugin * plugin;
   GtkWidget *button;
-  GtkWidget *box;
-  GtkWidget *date_label;
-  GtkWidget *time_label;
-  guint update_interval_ms;  /* time between updates in milliseconds */
-  guint timeout_id;
-  guint tooltip_timeout_id;
+  t_datetime_display *display;  /* draws the date, time and zones lines */
+  guint style_idle_id;  /* applies the fonts after startup */
+  guint update_units;  /* t_datetime_unit mask of the fields shown */
+  t_datetime_tick *tick;  /* subscription to the shared ticker */
+  guint frame_tick_id;  /* renders sub-second fields with the frame clock */
+  t_datetime_screensaver *screensaver;  /* nothing is shown while it is active */
+  t_datetime_tick *tooltip_tick;  /* refreshes the tooltip while it is shown */
+  gchar *tooltip_text;
+  gboolean tooltip_queried;  /* GTK asked for the tooltip since the last refresh */
   gulong tooltip_handler_id;
+  t_datetime_stats stats;
+  guint stats_log_id;  /* logs stats periodically if asked to */
 
   /* settings */
   gchar *date_font;
@@ -55,32 +64,68 @@ typedef struct {
   gchar *date_format;
   gchar *time_format;
   t_layout layout;
+  gboolean power_saving;  /* use coalesced second timers */
+  guint timer_slack;      /* refresh interval of seconds in power saving mode */
+  gchar *time_zones;      /* "LABEL=Area/City;..." shown by LAYOUT_WORLD */
+  gchar *calendars;       /* ";"-separated .ics files shown in the calendar */
+  guint settings_dirty;  /* DATETIME_CHANGED_* mask not in the rc file yet */
+  GFileMonitor *rc_monitor;  /* applies changes made by others */
+  guint settings_changed;  /* DATETIME_CHANGED_* mask not applied yet */
+  guint settings_depth;    /* nesting of datetime_settings_begin() */
+  guint settings_idle_id;  /* applies settings_changed */
+
+  /* compiled date_format and time_format */
+  t_datetime_format *date_program;
+  t_datetime_format *time_program;
+
+  /* zones of time_zones with their last rendered time */
+  t_datetime_world *world;
+
+  /* events of calendars */
+  t_datetime_events *events;
 
   /* option widgets */
+  GtkWidget *timer_slack_spin;
+  GtkWidget *time_zones_entry;
+  GtkWidget *calendars_entry;
   GtkWidget *date_frame;
   GtkWidget *date_tooltip_label;
   GtkWidget *date_font_hbox;
   GtkWidget *date_font_selector;
   GtkWidget *date_format_combobox;
   GtkWidget *date_format_entry;
+  GtkWidget *date_format_preview;
   GtkWidget *time_frame;
   GtkWidget *time_tooltip_label;
   GtkWidget *time_font_hbox;
   GtkWidget *time_font_selector;
   GtkWidget *time_format_combobox;
   GtkWidget *time_format_entry;
+  GtkWidget *time_format_preview;
+  guint format_preview_timeout_id;
+  GtkWidget *stats_label;
+  guint stats_timeout_id;  /* refreshes stats_label */
 
-  /* popup calendar */
+  /* popup calendar, hidden while closed */
   GtkWidget *cal;
+  GtkWidget *calendar;
+  guint cal_idle_id;      /* builds cal after startup */
+  gint64 cal_click_time;  /* monotonic time of the click opening cal */
+
+#ifdef DEBUG
+  gint64 construct_time;
+  gulong first_draw_handler_id;
+#endif
 } t_datetime;
 
 void
 datetime_update(t_datetime *datetime);
 
-gchar *
-datetime_do_utf8strftime(
-    const char *format,
-    const struct tm *tm);
+void
+datetime_settings_begin(t_datetime *datetime);
+
+void
+datetime_settings_commit(t_datetime *datetime);
 
 void
 datetime_apply_font(t_datetime *datetime,
@@ -96,6 +141,19 @@ void
 datetime_apply_layout(t_datetime *datetime,
     t_layout layout);
 
+void
+datetime_apply_power_saving(t_datetime *datetime,
+    gboolean power_saving,
+    guint timer_slack);
+
+void
+datetime_apply_time_zones(t_datetime *datetime,
+    const gchar *time_zones);
+
+void
+datetime_apply_calendars(t_datetime *datetime,
+    const gchar *calendars);
+
 void
 datetime_write_rc_file(XfcePanelPlugin *plugin,
     t_datetime *dt);
@@ -0,0 +1,309 @@
+/*  $Id$
+ *
+ *  Copyright (C) 2003 Choe Hwanjin(krisna@kldp.org)
+ *  Copyright (c) 2006 Remco den Breeje <remco@sx.mine.nu>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Creates and frees the plugin over and over, changing its settings,
+ * popping up the calendar and opening the properties dialog in between,
+ * and fails if the resident memory or the number of live GObjects grows
+ * with the cycles:
+ *
+ *   test-lifecycle [CYCLES]
+ *
+ * It needs a display, e.g. "xvfb-run make check", or GDK_BACKEND=broadway
+ * with broadwayd running, and is skipped without one.  GObjects are only
+ * counted with GOBJECT_DEBUG=instance-count and a GLib that supports it.
+ */
+
+/* the plugin's static functions are what the panel drives */
+#include "datetime.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+
+#include "datetime-presets.h"
+
+#define TEST_CYCLES 1000
+
+/* cycles run before measuring, to fill the caches of GTK and Pango */
+#define TEST_WARMUP_CYCLES 50
+
+/* settings changes per cycle */
+#define TEST_ROUNDS 4
+
+/* growth over all measured cycles below which nothing leaks per cycle */
+#define TEST_MAX_RSS_GROWTH_KB 2048
+#define TEST_MAX_OBJECT_GROWTH 16
+
+/* skipped, in the automake test protocol */
+#define TEST_SKIP 77
+
+static const gchar *test_fonts[] = {
+  "Sans 10",
+  "Monospace Bold 12",
+  "Serif Italic 8"
+};
+
+static const gchar *test_zones[] = {
+  "",
+  "UTC",
+  "New York=America/New_York;Asia/Tokyo;Nowhere/Atlantis"
+};
+
+static const gchar test_calendar[] =
+  "BEGIN:VCALENDAR\r\n"
+  "VERSION:2.0\r\n"
+  "BEGIN:VEVENT\r\n"
+  "UID:test-lifecycle\r\n"
+  "DTSTART;VALUE=DATE:20240101\r\n"
+  "RRULE:FREQ=WEEKLY;BYDAY=MO,WE,FR\r\n"
+  "SUMMARY:Stand-up\r\n"
+  "END:VEVENT\r\n"
+  "END:VCALENDAR\r\n";
+
+/*
+ * run what the cycle queued: idles, the settings transaction, file monitors;
+ * bounded, as a visible clock always has something to redraw
+ */
+static void test_iterate(void)
+{
+  guint i;
+
+  for (i = 0; i < 100 && g_main_context_pending(NULL); i++)
+    g_main_context_iteration(NULL, FALSE);
+}
+
+static glong test_rss_kb(void)
+{
+  glong size, resident;
+  FILE *statm;
+
+  statm = fopen("/proc/self/statm", "r");
+  if (statm == NULL)
+    return -1;
+
+  if (fscanf(statm, "%ld %ld", &size, &resident) != 2)
+    resident = -1;
+  fclose(statm);
+
+  return (resident < 0) ? -1 : resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static gint test_count_instances(GType type)
+{
+  GType *children;
+  guint n_children, i;
+  gint count;
+
+  count = g_type_get_instance_count(type);
+
+  children = g_type_children(type, &n_children);
+  for (i = 0; i < n_children; i++)
+    count += test_count_instances(children[i]);
+  g_free(children);
+
+  return count;
+}
+
+/*
+ * remove what the plugin wrote: the rc file, the events cache and the
+ * calendar the test gave it
+ */
+static void test_remove_tree(const gchar *path)
+{
+  GDir *dir;
+  const gchar *name;
+  gchar *child;
+
+  dir = g_dir_open(path, 0, NULL);
+  if (dir == NULL)
+  {
+    g_unlink(path);
+    return;
+  }
+
+  while ((name = g_dir_read_name(dir)) != NULL)
+  {
+    child = g_build_filename(path, name, NULL);
+    test_remove_tree(child);
+    g_free(child);
+  }
+  g_dir_close(dir);
+  g_rmdir(path);
+}
+
+static void test_apply_settings(t_datetime *datetime, guint cycle,
+                                const gchar *calendar_file)
+{
+  const dt_combobox_item *date, *time;
+  guint round, n;
+
+  for (round = 0; round < TEST_ROUNDS; round++)
+  {
+    n = cycle * TEST_ROUNDS + round;
+    date = &dt_combobox_date[n % DT_COMBOBOX_DATE_COUNT];
+    time = &dt_combobox_time[n % DT_COMBOBOX_TIME_COUNT];
+
+    /* half of the rounds as one transaction, like reading the rc file */
+    if (n & 1)
+      datetime_settings_begin(datetime);
+
+    datetime_apply_layout(datetime, n % LAYOUT_COUNT);
+    datetime_apply_format(datetime,
+        date->type == DT_COMBOBOX_ITEM_TYPE_STANDARD ? date->item : "%d.%m. %N",
+        time->type == DT_COMBOBOX_ITEM_TYPE_STANDARD ? time->item : "%T.%3N");
+    datetime_apply_font(datetime, test_fonts[n % G_N_ELEMENTS(test_fonts)],
+                        test_fonts[(n + 1) % G_N_ELEMENTS(test_fonts)]);
+    datetime_apply_time_zones(datetime, test_zones[n % G_N_ELEMENTS(test_zones)]);
+    datetime_apply_calendars(datetime, (n & 2) ? calendar_file : "");
+    datetime_apply_power_saving(datetime, n & 1, 1 + n % 10);
+
+    if (n & 1)
+      datetime_settings_commit(datetime);
+
+    test_iterate();
+  }
+}
+
+static void test_cycle(GtkWidget *window, guint cycle,
+                       const gchar *calendar_file)
+{
+  XfcePanelPlugin *plugin;
+  t_datetime *datetime;
+  GtkWidget *dlg;
+
+  /* as XFCE_PANEL_PLUGIN_REGISTER and datetime_construct() do */
+  plugin = g_object_new(XFCE_TYPE_PANEL_PLUGIN,
+                        "name", "datetime",
+                        "unique-id", 1,
+                        NULL);
+  datetime = datetime_new(plugin);
+  gtk_container_add(GTK_CONTAINER(plugin), datetime->button);
+  gtk_container_add(GTK_CONTAINER(window), GTK_WIDGET(plugin));
+  gtk_widget_show(GTK_WIDGET(plugin));
+  test_iterate();
+
+  test_apply_settings(datetime, cycle, calendar_file);
+  datetime_set_mode(plugin, (cycle & 1) ? XFCE_PANEL_PLUGIN_MODE_VERTICAL :
+                    XFCE_PANEL_PLUGIN_MODE_HORIZONTAL, datetime);
+  test_iterate();
+
+  pop_calendar_window(datetime);
+  test_iterate();
+  close_calendar_window(datetime);
+
+  /* closed by the user, or left open for datetime_free() to destroy */
+  datetime_properties_dialog(plugin, datetime);
+  test_iterate();
+  if (cycle & 1)
+  {
+    dlg = g_object_get_data(G_OBJECT(plugin), "dialog");
+    gtk_dialog_response(GTK_DIALOG(dlg), GTK_RESPONSE_OK);
+    test_iterate();
+  }
+
+  datetime_free(plugin, datetime);
+  gtk_widget_destroy(GTK_WIDGET(plugin));
+  test_iterate();
+}
+
+int main(int argc, char **argv)
+{
+  GtkWidget *window;
+  gchar *config_dir, *calendar_file;
+  glong rss_before, rss_after;
+  gint objects_before, objects_after;
+  guint cycles = TEST_CYCLES;
+  guint i;
+  gint status = EXIT_SUCCESS;
+
+  if (argc > 1)
+    cycles = MAX(strtoul(argv[1], NULL, 10), 1);
+
+  /* keep the user's settings and events cache out of it */
+  config_dir = g_dir_make_tmp("datetime-test-XXXXXX", NULL);
+  if (config_dir == NULL)
+    return EXIT_FAILURE;
+  g_setenv("XDG_CONFIG_HOME", config_dir, TRUE);
+  g_setenv("XDG_CACHE_HOME", config_dir, TRUE);
+
+  if (!gtk_init_check(&argc, &argv))
+  {
+    g_print("no display, skipped\n");
+    g_rmdir(config_dir);
+    g_free(config_dir);
+    return TEST_SKIP;
+  }
+
+  calendar_file = g_build_filename(config_dir, "test.ics", NULL);
+  g_file_set_contents(calendar_file, test_calendar, -1, NULL);
+
+  window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
+  gtk_widget_show(window);
+
+  for (i = 0; i < TEST_WARMUP_CYCLES; i++)
+    test_cycle(window, i, calendar_file);
+
+  rss_before = test_rss_kb();
+  objects_before = test_count_instances(G_TYPE_OBJECT);
+
+  for (i = 0; i < cycles; i++)
+    test_cycle(window, TEST_WARMUP_CYCLES + i, calendar_file);
+
+  rss_after = test_rss_kb();
+  objects_after = test_count_instances(G_TYPE_OBJECT);
+
+  if (rss_before < 0 || rss_after < 0)
+    g_print("RSS: n/a\n");
+  else
+  {
+    g_print("RSS: %ld KiB -> %ld KiB over %u cycles\n",
+            rss_before, rss_after, cycles);
+    if (rss_after - rss_before > TEST_MAX_RSS_GROWTH_KB)
+    {
+      g_printerr("FAIL: RSS grew by %.2f KiB per cycle\n",
+                 (gdouble) (rss_after - rss_before) / cycles);
+      status = EXIT_FAILURE;
+    }
+  }
+
+  if (objects_before == 0)
+    g_print("GObjects: n/a, run with GOBJECT_DEBUG=instance-count\n");
+  else
+  {
+    g_print("GObjects: %d -> %d over %u cycles\n",
+            objects_before, objects_after, cycles);
+    if (objects_after - objects_before > TEST_MAX_OBJECT_GROWTH)
+    {
+      g_printerr("FAIL: %d GObjects left behind\n",
+                 objects_after - objects_before);
+      status = EXIT_FAILURE;
+    }
+  }
+
+  gtk_widget_destroy(window);
+
+  test_remove_tree(config_dir);
+  g_free(calendar_file);
+  g_free(config_dir);
+
+  return status;
+}
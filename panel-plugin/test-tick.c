@@ -0,0 +1,414 @@
+/*  $Id$
+ *
+ *  Copyright (C) 2003 Choe Hwanjin(krisna@kldp.org)
+ *  Copyright (c) 2006 Remco den Breeje <remco@sx.mine.nu>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU Library General Public License as published
+ *  by the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Library General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Library General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * Replays a day through the shared ticker on a fake clock, across the
+ * switch to summer time and, in some cases, a change of the clock, and
+ * checks that
+ *  - every subscription shows what strftime() shows for the current time,
+ *    and never keeps a text past its change (by more than the timer slack
+ *    in power saving mode);
+ *  - the text follows the clock as soon as it is set;
+ *  - the ticker wakes as often as datetime_tick_count_wakeups() predicts.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+/* local includes */
+#include <time.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* xfce includes */
+#include <libxfce4util/libxfce4util.h>
+
+#include "datetime-format.h"
+#include "datetime-source.h"
+#include "datetime-tick.h"
+
+/* Central European Time, without depending on the tz database */
+#define TEST_TZ "CET-1CEST,M3.5.0,M10.5.0/3"
+
+/* 2024-03-30 12:00 UTC, 13 hours before the clocks go forward */
+#define TEST_START_MS G_GINT64_CONSTANT(1711800000000)
+#define TEST_DAY_MS   G_GINT64_CONSTANT(86400000)
+
+/* when the clock is set in the cases that set it: 19:00:00.400 CET */
+#define TEST_SET_AFTER_MS G_GINT64_CONSTANT(21600400)
+
+#define TEST_HOUR_MS  G_GINT64_CONSTANT(3600000)
+
+typedef struct {
+  const gchar *format;
+  gboolean power_saving;
+  guint timer_slack;
+  gint64 start_offset_ms;  /* from TEST_START_MS */
+  gint64 set_by_ms;        /* clock set TEST_SET_AFTER_MS in, 0 if never */
+} t_test_case;
+
+static const t_test_case test_cases[] = {
+  { "%H:%M",                  FALSE, 1,  0,   0 },
+  { "%H:%M",                  FALSE, 1,  250, 0 },
+  { "%H:%M:%S",               FALSE, 1,  250, 0 },
+  { "%T.%1N",                 FALSE, 1,  250, 0 },
+  { "%l:%M %P",               FALSE, 1,  0,   0 },
+  { "%Y-%m-%d",               FALSE, 1,  0,   0 },
+  { "%a %d %b %Y %H:%M %Z",   FALSE, 1,  0,   0 },
+  { "%H:%M",                  TRUE,  1,  0,   0 },
+  { "%H:%M %Z",               TRUE,  1,  0,   0 },
+  { "%H:%M:%S",               TRUE,  1,  0,   0 },
+  { "%H:%M:%S",               TRUE,  10, 0,   0 },
+  { "%T.%1N",                 TRUE,  1,  0,   0 },
+  { "%Y-%m-%d",               TRUE,  60, 0,   0 },
+
+  /* set back, e.g. by an NTP step, and forward, e.g. by a resume */
+  { "%H:%M",                  FALSE, 1,  0,   -TEST_HOUR_MS * 3 / 2 + 123 },
+  { "%H:%M:%S",               FALSE, 1,  250, -TEST_HOUR_MS / 2 },
+  { "%T.%1N",                 FALSE, 1,  0,   -TEST_HOUR_MS + 50 },
+  { "%Y-%m-%d",               FALSE, 1,  0,   -TEST_HOUR_MS * 20 },
+  { "%H:%M",                  TRUE,  1,  0,   -TEST_HOUR_MS * 2 },
+  { "%H:%M:%S",               TRUE,  10, 0,   -TEST_HOUR_MS / 4 + 700 },
+  { "%H:%M",                  FALSE, 1,  0,   TEST_HOUR_MS * 3 + 500 },
+  { "%H:%M:%S",               FALSE, 1,  250, TEST_HOUR_MS / 2 },
+  { "%T.%1N",                 FALSE, 1,  0,   TEST_HOUR_MS + 50 },
+  { "%Y-%m-%d",               FALSE, 1,  0,   TEST_HOUR_MS * 6 },
+  { "%H:%M",                  TRUE,  1,  0,   TEST_HOUR_MS * 2 + 300 },
+  { "%H:%M:%S",               TRUE,  10, 0,   TEST_HOUR_MS / 4 }
+};
+
+/*
+ * fake clock: time only moves when the test moves it, and the sources
+ * are ready once it reaches their target
+ */
+typedef struct {
+  GSource source;
+  gint64 target_ms;
+  gboolean clock_set;  /* ready now, as a timerfd with TFD_TIMER_CANCEL_ON_SET */
+} t_fake_source;
+
+static gint64 fake_now_ms;
+static t_fake_source *fake_wall_source;
+static t_fake_source *fake_seconds_source;
+
+static gint64 fake_get_time(void)
+{
+  return fake_now_ms;
+}
+
+static gboolean fake_source_prepare(GSource *source, gint *timeout)
+{
+  t_fake_source *fsource = (t_fake_source *) source;
+
+  *timeout = -1;
+  return fsource->clock_set || fake_now_ms >= fsource->target_ms;
+}
+
+static gboolean fake_source_check(GSource *source)
+{
+  t_fake_source *fsource = (t_fake_source *) source;
+
+  return fsource->clock_set || fake_now_ms >= fsource->target_ms;
+}
+
+static gboolean fake_source_dispatch(GSource *source,
+                                     GSourceFunc callback,
+                                     gpointer user_data)
+{
+  t_fake_source *fsource = (t_fake_source *) source;
+  gint64 target_ms = fsource->target_ms;
+
+  /* nothing is due until the callback sets the next target */
+  fsource->target_ms = G_MAXINT64;
+  fsource->clock_set = FALSE;
+
+  if (callback == NULL)
+    return G_SOURCE_CONTINUE;
+
+  return ((t_datetime_source_func) callback)(target_ms, user_data);
+}
+
+static GSourceFuncs fake_source_funcs = {
+  fake_source_prepare,
+  fake_source_check,
+  fake_source_dispatch,
+  NULL
+};
+
+static GSource * fake_source_new(t_fake_source **location)
+{
+  GSource *source = g_source_new(&fake_source_funcs, sizeof(t_fake_source));
+
+  ((t_fake_source *) source)->target_ms = G_MAXINT64;
+  *location = (t_fake_source *) source;
+
+  return source;
+}
+
+static GSource * fake_wall_source_new(void)
+{
+  return fake_source_new(&fake_wall_source);
+}
+
+static GSource * fake_seconds_source_new(void)
+{
+  return fake_source_new(&fake_seconds_source);
+}
+
+static void fake_wall_source_set_target(GSource *source, gint64 target_ms)
+{
+  ((t_fake_source *) source)->target_ms = target_ms;
+}
+
+/* GLib's second timers with a perturbation of 0, on whole seconds */
+static void fake_seconds_source_set_interval(GSource *source, guint interval_s)
+{
+  ((t_fake_source *) source)->target_ms =
+    (interval_s == 0) ? G_MAXINT64 : fake_now_ms + (gint64) interval_s * 1000;
+}
+
+/*
+ * Set the clock: the wall-clock source is woken, while GLib's second timers
+ * count on the monotonic clock and keep the time they had left.
+ */
+static void fake_set_clock(gint64 time_ms)
+{
+  if (fake_seconds_source->target_ms != G_MAXINT64)
+    fake_seconds_source->target_ms += time_ms - fake_now_ms;
+
+  fake_now_ms = time_ms;
+  fake_wall_source->clock_set = TRUE;
+}
+
+static const t_datetime_clock fake_clock = {
+  fake_get_time,
+  fake_wall_source_new,
+  fake_wall_source_set_target,
+  fake_seconds_source_new,
+  fake_seconds_source_set_interval
+};
+
+typedef struct {
+  const t_test_case *test;
+  t_datetime_format *program;
+  gchar text[DATETIME_MAX_STRLEN];  /* what the subscription shows */
+  guint failures;
+} t_test_state;
+
+#define test_fail(state, ...) G_STMT_START { \
+  g_printerr("FAIL %s%s%s: ", (state)->test->format, \
+             (state)->test->power_saving ? " (power saving)" : "", \
+             test_clock_set_name((state)->test)); \
+  g_printerr(__VA_ARGS__); \
+  g_printerr("\n"); \
+  (state)->failures++; \
+} G_STMT_END
+
+/*
+ * what the panel should show at time_ms, by the C library;
+ * GNU date's %N and %1N to %9N are filled in first, strftime() lacks them
+ */
+static void test_expected(const gchar *format, gint64 time_ms,
+                          gchar *buf, gsize buf_size)
+{
+  time_t t = time_ms / 1000;
+  struct tm tm;
+  GString *expanded;
+  gchar nanoseconds[16];
+  const gchar *p;
+
+  g_snprintf(nanoseconds, sizeof(nanoseconds), "%09d",
+             (gint) (time_ms % 1000) * 1000000);
+
+  expanded = g_string_new(NULL);
+  for (p = format; *p != '\0'; p++)
+  {
+    if (p[0] == '%' && p[1] == '%')
+      g_string_append(expanded, "%%");
+    else if (p[0] == '%' && p[1] == 'N')
+      g_string_append(expanded, nanoseconds);
+    else if (p[0] == '%' && p[1] >= '1' && p[1] <= '9' && p[2] == 'N')
+      g_string_append_len(expanded, nanoseconds, p[1] - '0');
+    else
+    {
+      g_string_append_c(expanded, *p);
+      continue;
+    }
+
+    p += (p[1] == 'N' || p[1] == '%') ? 1 : 2;
+  }
+
+  localtime_r(&t, &tm);
+  if (strftime(buf, buf_size, expanded->str, &tm) == 0)
+    buf[0] = '\0';
+
+  g_string_free(expanded, TRUE);
+}
+
+static const gchar * test_clock_set_name(const t_test_case *test)
+{
+  if (test->set_by_ms < 0)
+    return " (clock set back)";
+  if (test->set_by_ms > 0)
+    return " (clock set forward)";
+  return "";
+}
+
+static void test_tick_cb(const struct tm *tm, gint64 time_ms,
+                         gpointer user_data)
+{
+  t_test_state *state = user_data;
+  gchar expected[DATETIME_MAX_STRLEN];
+
+  if (time_ms != fake_now_ms)
+    test_fail(state, "called with %" G_GINT64_FORMAT " at %" G_GINT64_FORMAT,
+              time_ms, fake_now_ms);
+
+  datetime_format_render(state->program, tm, time_ms % 1000,
+                         state->text, sizeof(state->text));
+
+  test_expected(state->test->format, fake_now_ms, expected, sizeof(expected));
+  if (strcmp(state->text, expected) != 0)
+    test_fail(state, "\"%s\" rendered at %" G_GINT64_FORMAT ", expected \"%s\"",
+              state->text, fake_now_ms, expected);
+}
+
+static guint test_run(const t_test_case *test)
+{
+  t_test_state state = { test, NULL, "", 0 };
+  t_datetime_tick *tick;
+  gchar expected[DATETIME_MAX_STRLEN];
+  gchar previous[DATETIME_MAX_STRLEN];
+  gint64 start_ms = TEST_START_MS + test->start_offset_ms;
+  gint64 end_ms = start_ms + TEST_DAY_MS;
+  gint64 set_at_ms = start_ms + TEST_SET_AFTER_MS;
+  gint64 next_ms, until_ms, lag_ms;
+  gboolean set = (test->set_by_ms == 0);
+  guint units, wakeups = 0, predicted = 0;
+
+  state.program = datetime_format_compile(test->format);
+  units = datetime_format_get_units(state.program);
+
+  /*
+   * how long the text may trail the time: the slack when showing seconds
+   * in power saving mode, else the rounding up of GLib's second timers
+   */
+  if (!test->power_saving)
+    lag_ms = 0;
+  else if (units & DATETIME_UNIT_SECOND)
+    lag_ms = (gint64) test->timer_slack * 1000;
+  else
+    lag_ms = 1250 + 999;
+
+  fake_now_ms = start_ms;
+  tick = datetime_tick_subscribe(test_tick_cb, &state);
+  datetime_tick_schedule(tick, units, test->power_saving, test->timer_slack);
+  test_expected(test->format, fake_now_ms, state.text, sizeof(state.text));
+
+  for (;;)
+  {
+    next_ms = MIN(fake_wall_source->target_ms, fake_seconds_source->target_ms);
+    if (next_ms <= fake_now_ms)
+    {
+      test_fail(&state, "not re-armed at %" G_GINT64_FORMAT, fake_now_ms);
+      break;
+    }
+
+    /* the text must hold until the next wakeup, or until the clock is set */
+    until_ms = (!set && next_ms > set_at_ms) ? set_at_ms + 1 : next_ms;
+    if (until_ms - 1 - lag_ms >= fake_now_ms)
+    {
+      test_expected(test->format, until_ms - 1 - lag_ms, expected, sizeof(expected));
+      if (strcmp(state.text, expected) != 0)
+        test_fail(&state, "\"%s\" still shown at %" G_GINT64_FORMAT ", expected \"%s\"",
+                  state.text, until_ms - 1 - lag_ms, expected);
+    }
+
+    if (state.failures > 10)
+      break;
+
+    if (!set && next_ms > set_at_ms)
+    {
+      /* the schedule starts over from the new time, after one wakeup */
+      predicted += datetime_tick_count_wakeups(units, test->power_saving,
+                                               test->timer_slack, start_ms, set_at_ms) + 1;
+      start_ms = set_at_ms + test->set_by_ms;
+      end_ms += test->set_by_ms;
+      set = TRUE;
+
+      fake_set_clock(start_ms);
+      wakeups++;
+      g_main_context_iteration(NULL, FALSE);
+
+      test_expected(test->format, fake_now_ms, expected, sizeof(expected));
+      if (strcmp(state.text, expected) != 0)
+        test_fail(&state, "\"%s\" shown after setting the clock to %" G_GINT64_FORMAT
+                  ", expected \"%s\"", state.text, fake_now_ms, expected);
+      continue;
+    }
+
+    if (next_ms > end_ms)
+      break;
+
+    fake_now_ms = next_ms;
+    wakeups++;
+    g_strlcpy(previous, state.text, sizeof(previous));
+    g_main_context_iteration(NULL, FALSE);
+
+    /* a precise subscription only wakes for a change */
+    if (!test->power_saving && strcmp(state.text, previous) == 0)
+      test_fail(&state, "woken at %" G_GINT64_FORMAT " for nothing", fake_now_ms);
+  }
+
+  predicted += datetime_tick_count_wakeups(units, test->power_saving,
+                                           test->timer_slack, start_ms, end_ms);
+  if (wakeups != predicted)
+    test_fail(&state, "%u wakeups, %u predicted", wakeups, predicted);
+
+  datetime_tick_unsubscribe(tick);
+  datetime_format_free(state.program);
+
+  return state.failures;
+}
+
+int main(int argc, char **argv)
+{
+  guint failures = 0;
+  guint i;
+
+  g_setenv("TZ", TEST_TZ, TRUE);
+  tzset();
+
+  datetime_tick_set_clock(&fake_clock);
+
+  for (i = 0; i < G_N_ELEMENTS(test_cases); i++)
+  {
+    if (test_run(&test_cases[i]) == 0)
+      g_print("ok %s%s%s\n", test_cases[i].format,
+              test_cases[i].power_saving ? " (power saving)" : "",
+              test_clock_set_name(&test_cases[i]));
+    else
+      failures++;
+  }
+
+  return (failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}